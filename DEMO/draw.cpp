@@ -420,18 +420,15 @@ void Painter::update(DSC::DeformableSimplicialComplex<>& dsc)
 void Painter::update_interface(DSC::DeformableSimplicialComplex<>& dsc)
 {
     std::vector<vec3> data;
-    for (auto fit = dsc.faces_begin(); fit != dsc.faces_end(); fit++)
+    for (auto f : dsc.get_interface_faces())
     {
-        if (fit->is_interface())
+        auto verts = dsc.get_pos(dsc.get_sorted_nodes(f));
+        vec3 normal = Util::normal_direction(verts[0], verts[1], verts[2]);
+        
+        for(auto &p : verts)
         {
-            auto verts = dsc.get_pos(dsc.get_sorted_nodes(fit.key()));
-            vec3 normal = Util::normal_direction(verts[0], verts[1], verts[2]);
-            
-            for(auto &p : verts)
-            {
-                data.push_back(p);
-                data.push_back(normal);
-            }
+            data.push_back(p);
+            data.push_back(normal);
         }
     }
     interface->add_data(data);
@@ -440,18 +437,15 @@ void Painter::update_interface(DSC::DeformableSimplicialComplex<>& dsc)
 void Painter::update_wire_frame(DSC::DeformableSimplicialComplex<>& dsc)
 {
     std::vector<vec3> data;
-    for (auto fit = dsc.faces_begin(); fit != dsc.faces_end(); fit++)
+    for (auto f : dsc.get_interface_faces())
     {
-        if (fit->is_interface())
+        auto verts = dsc.get_pos(dsc.get_sorted_nodes(f));
+        vec3 normal = Util::normal_direction(verts[0], verts[1], verts[2]);
+        
+        for(auto &p : verts)
         {
-            auto verts = dsc.get_pos(dsc.get_sorted_nodes(fit.key()));
-            vec3 normal = Util::normal_direction(verts[0], verts[1], verts[2]);
-            
-            for(auto &p : verts)
-            {
-                data.push_back(p);
-                data.push_back(normal);
-            }
+            data.push_back(p);
+            data.push_back(normal);
         }
     }
     wire_frame->add_data(data);
@@ -136,17 +136,17 @@ namespace is_mesh {
             return *this;
         }
         
-        bool is_crossing()
+        bool is_crossing() const
         {
             return flags[2];
         }
         
-        bool is_boundary()
+        bool is_boundary() const
         {
             return flags[1];
         }
         
-        bool is_interface()
+        bool is_interface() const
         {
             return flags[0];
         }
@@ -194,12 +194,12 @@ namespace is_mesh {
             return *this;
         }
         
-        bool is_boundary()
+        bool is_boundary() const
         {
             return flags[1];
         }
         
-        bool is_interface()
+        bool is_interface() const
         {
             return flags[0];
         }
@@ -244,7 +244,7 @@ namespace is_mesh {
         }
 
         
-        int label()
+        int label() const
         {
             return l;
         }
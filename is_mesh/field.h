@@ -0,0 +1,353 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util.h"
+#include "paged_array.h"
+#include "simplex_set.h"
+
+namespace is_mesh
+{
+    /**
+     * Specifies how the value of a field is set on a simplex created by an edit (split, collapse, flip or merge) from the
+     * values on the simplices it replaces:
+     * INTERPOLATE: The weighted average of the replaced values. Types without + and * by a scalar are copied instead.
+     * COPY: The value of the replaced simplex with the largest weight.
+     * DEFAULT: The default value of the field.
+     */
+    enum TransferRule {INTERPOLATE, COPY, DEFAULT};
+
+    namespace field_detail
+    {
+        inline unsigned int max_weight(const std::vector<real>& weights)
+        {
+            unsigned int m = 0;
+            for (unsigned int i = 1; i < weights.size(); i++)
+            {
+                if(weights[i] > weights[m])
+                {
+                    m = i;
+                }
+            }
+            return m;
+        }
+
+        /**
+         * Returns the weighted sum of the values at from. Used for types supporting + and * by a scalar.
+         */
+        template<typename T>
+        auto weighted_sum(const PagedArray<T>& values, const std::vector<size_t>& from, const std::vector<real>& weights, int)
+            -> decltype(values[0]*weights[0] + values[0]*weights[0], T())
+        {
+            T result = values[from[0]]*weights[0];
+            for (unsigned int i = 1; i < from.size(); i++)
+            {
+                result = result + values[from[i]]*weights[i];
+            }
+            return result;
+        }
+
+        /**
+         * Returns the value at from with the largest weight. Used for all other types.
+         */
+        template<typename T>
+        T weighted_sum(const PagedArray<T>& values, const std::vector<size_t>& from, const std::vector<real>& weights, long)
+        {
+            return values[from[max_weight(weights)]];
+        }
+    }
+
+    class FieldBase
+    {
+        TransferRule rule;
+
+    public:
+        FieldBase(TransferRule rule_) : rule(rule_)
+        {
+
+        }
+
+        virtual ~FieldBase()
+        {
+
+        }
+
+        TransferRule get_rule() const
+        {
+            return rule;
+        }
+
+        virtual FieldBase* clone() const = 0;
+
+        virtual void resize(size_t size) = 0;
+
+        virtual void reset(size_t k) = 0;
+
+        virtual void copy(size_t to, size_t from) = 0;
+
+        virtual void interpolate(size_t to, const std::vector<size_t>& from, const std::vector<real>& weights) = 0;
+
+        virtual void detach() = 0;
+
+        /**
+         * Sets the value at to from the values at from according to the transfer rule.
+         */
+        void transfer(size_t to, const std::vector<size_t>& from, const std::vector<real>& weights)
+        {
+            if(rule == DEFAULT || from.empty())
+            {
+                reset(to);
+            }
+            else if(rule == COPY || from.size() == 1)
+            {
+                copy(to, from[field_detail::max_weight(weights)]);
+            }
+            else {
+                interpolate(to, from, weights);
+            }
+        }
+    };
+
+    /**
+     * An array with one value of type T per simplex, indexed by the key of the simplex. The values are shared with copies of
+     * the field until either is written, see PagedArray.
+     */
+    template<typename T>
+    class Field : public FieldBase
+    {
+        PagedArray<T> values;
+        T default_value;
+
+    public:
+        Field(const T& default_value_, TransferRule rule) : FieldBase(rule), default_value(default_value_)
+        {
+
+        }
+
+        typename PagedArray<T>::reference operator[](size_t k)
+        {
+            assert(k < values.size());
+            return values.write(k);
+        }
+
+        typename PagedArray<T>::const_reference operator[](size_t k) const
+        {
+            assert(k < values.size());
+            return values[k];
+        }
+
+        const T& get_default() const
+        {
+            return default_value;
+        }
+
+        virtual FieldBase* clone() const
+        {
+            return new Field<T>(*this);
+        }
+
+        virtual void resize(size_t size)
+        {
+            if(size > values.size())
+            {
+                values.resize(size, default_value);
+            }
+        }
+
+        virtual void reset(size_t k)
+        {
+            values.write(k) = default_value;
+        }
+
+        virtual void copy(size_t to, size_t from)
+        {
+            values.write(to) = values[from];
+        }
+
+        virtual void interpolate(size_t to, const std::vector<size_t>& from, const std::vector<real>& weights)
+        {
+            real sum = 0.;
+            for (auto w : weights)
+            {
+                sum += w;
+            }
+            std::vector<real> normalized(weights);
+            for (auto& w : normalized)
+            {
+                w /= sum;
+            }
+            values.write(to) = field_detail::weighted_sum(values, from, normalized, 0);
+        }
+
+        virtual void detach()
+        {
+            values.detach();
+        }
+    };
+
+    /**
+     * The named fields attached to the simplices of one dimension. The mesh keeps the fields sized to the simplices and
+     * transfers the values when simplices are created by edits.
+     */
+    template<typename key_type>
+    class FieldRegistry
+    {
+        std::vector<std::pair<std::string, FieldBase*>> fields;
+        size_t size = 0;
+
+        FieldBase* find(const std::string& name) const
+        {
+            for (auto& f : fields)
+            {
+                if(f.first == name)
+                {
+                    return f.second;
+                }
+            }
+            return nullptr;
+        }
+
+    public:
+        FieldRegistry()
+        {
+
+        }
+
+        ~FieldRegistry()
+        {
+            for (auto& f : fields)
+            {
+                delete f.second;
+            }
+        }
+
+        /**
+         * Copies the fields. The values are shared with the copy until either is written.
+         */
+        FieldRegistry(const FieldRegistry& registry) : size(registry.size)
+        {
+            for (auto& f : registry.fields)
+            {
+                fields.push_back({f.first, f.second->clone()});
+            }
+        }
+
+        FieldRegistry& operator=(const FieldRegistry&) = delete;
+
+        /**
+         * Adds a field with the given name, default value and transfer rule. Every existing simplex is given the default value.
+         */
+        template<typename T>
+        Field<T>& add(const std::string& name, const T& default_value = T(), TransferRule rule = INTERPOLATE)
+        {
+            assert(!contains(name));
+            Field<T>* field = new Field<T>(default_value, rule);
+            field->resize(size);
+            fields.push_back({name, field});
+            return *field;
+        }
+
+        /**
+         * Returns the field with the given name. The type T must be the type the field was added with.
+         */
+        template<typename T>
+        Field<T>& get(const std::string& name)
+        {
+            Field<T>* field = dynamic_cast<Field<T>*>(find(name));
+            assert(field);
+            return *field;
+        }
+
+        bool contains(const std::string& name) const
+        {
+            return find(name) != nullptr;
+        }
+
+        void remove(const std::string& name)
+        {
+            for (auto it = fields.begin(); it != fields.end(); it++)
+            {
+                if(it->first == name)
+                {
+                    delete it->second;
+                    fields.erase(it);
+                    return;
+                }
+            }
+        }
+
+        /**
+         * Called when the simplex k is inserted. Gives it the default value in all fields.
+         */
+        void insert(const key_type& k)
+        {
+            if(k >= size)
+            {
+                size = std::max(static_cast<size_t>(k) + 1, 2*size);
+                for (auto& f : fields)
+                {
+                    f.second->resize(size);
+                }
+            }
+            for (auto& f : fields)
+            {
+                f.second->reset(k);
+            }
+        }
+
+        /**
+         * Sets the values of the simplex k from the values of the simplices from, weighted by weights, according to the
+         * transfer rule of each field.
+         */
+        void transfer(const key_type& k, const SimplexSet<key_type>& from, const std::vector<real>& weights)
+        {
+            if(fields.empty())
+            {
+                return;
+            }
+            assert(from.size() == weights.size());
+            std::vector<size_t> indices(from.begin(), from.end());
+            for (auto& f : fields)
+            {
+                f.second->transfer(k, indices, weights);
+            }
+        }
+
+        /**
+         * Sets the values of the simplex k from the simplices from with equal weights.
+         */
+        void transfer(const key_type& k, const SimplexSet<key_type>& from)
+        {
+            transfer(k, from, std::vector<real>(from.size(), 1.));
+        }
+
+        /**
+         * Copies the values shared with copies of the fields.
+         */
+        void detach()
+        {
+            for (auto& f : fields)
+            {
+                f.second->detach();
+            }
+        }
+    };
+}
@@ -0,0 +1,177 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "paged_array.h"
+#include "simplex_set.h"
+
+namespace is_mesh
+{
+    /**
+     * A triangle adjacency view of the interface surface. It stores the interface faces and, for each node, the interface
+     * faces incident to it, such that surface queries do not have to search the volumetric star of a node. The mesh keeps
+     * it in sync when faces become or stop being interface, see ISMesh::update_flag().
+     */
+    template<typename node_key, typename face_key>
+    class InterfaceSurface
+    {
+        PagedArray<face_key> m_faces;
+        PagedArray<SimplexSet<node_key>> m_face_nodes;
+        PagedArray<int> m_face_index;
+        PagedArray<SimplexSet<face_key>> m_node_faces;
+        SimplexSet<face_key> m_empty;
+
+        template<typename T>
+        static void grow(PagedArray<T>& v, size_t k, const T& value)
+        {
+            if(k >= v.size())
+            {
+                v.resize(std::max(k + 1, 2*v.size()), value);
+            }
+        }
+
+    public:
+        /**
+         * Inserts the interface face fid with the nodes nids. If fid is already in the surface, its nodes are replaced.
+         */
+        void insert(const face_key& fid, const SimplexSet<node_key>& nids)
+        {
+            erase(fid);
+            grow(m_face_index, fid, -1);
+            m_face_index.write(fid) = static_cast<int>(m_faces.size());
+            m_faces.push_back(fid);
+            m_face_nodes.push_back(nids);
+            for (auto n : nids)
+            {
+                grow(m_node_faces, n, SimplexSet<face_key>());
+                m_node_faces.write(n).push_back(fid);
+            }
+        }
+
+        /**
+         * Removes the face fid from the surface if it is in the surface.
+         */
+        void erase(const face_key& fid)
+        {
+            if(!contains(fid))
+            {
+                return;
+            }
+            int i = m_face_index[fid];
+            for (auto n : m_face_nodes[i])
+            {
+                m_node_faces.write(n) -= fid;
+            }
+
+            m_faces.write(i) = m_faces.back();
+            m_face_nodes.write(i) = m_face_nodes.back();
+            m_face_index.write(m_faces[i]) = i;
+            m_faces.pop_back();
+            m_face_nodes.pop_back();
+            m_face_index.write(fid) = -1;
+        }
+
+        void clear()
+        {
+            m_faces.clear();
+            m_face_index.clear();
+            m_face_nodes.clear();
+            m_node_faces.clear();
+        }
+
+        /**
+         * Copies the memory shared with copies of the surface, see PagedArray::detach().
+         */
+        void detach()
+        {
+            m_faces.detach();
+            m_face_nodes.detach();
+            m_face_index.detach();
+            m_node_faces.detach();
+        }
+
+        bool contains(const face_key& fid) const
+        {
+            return static_cast<size_t>(fid) < m_face_index.size() && m_face_index[fid] >= 0;
+        }
+
+        size_t size() const
+        {
+            return m_faces.size();
+        }
+
+        /**
+         * Returns all interface faces in no particular order.
+         */
+        const PagedArray<face_key>& faces() const
+        {
+            return m_faces;
+        }
+
+        /**
+         * Returns the interface faces incident to the node nid.
+         */
+        const SimplexSet<face_key>& faces(const node_key& nid) const
+        {
+            if(static_cast<size_t>(nid) < m_node_faces.size())
+            {
+                return m_node_faces[nid];
+            }
+            return m_empty;
+        }
+
+        /**
+         * Returns the nodes of the interface face fid.
+         */
+        const SimplexSet<node_key>& nodes(const face_key& fid) const
+        {
+            assert(contains(fid));
+            return m_face_nodes[m_face_index[fid]];
+        }
+
+        /**
+         * Returns the nodes which share an interface face with the node nid.
+         */
+        SimplexSet<node_key> neighbours(const node_key& nid) const
+        {
+            SimplexSet<node_key> nids;
+            for (auto f : faces(nid))
+            {
+                nids += nodes(f);
+            }
+            return nids - nid;
+        }
+
+        /**
+         * Returns the interface faces which share an edge with the interface face fid. An edge shared by more than two
+         * interface faces (a crossing) contributes all of them.
+         */
+        SimplexSet<face_key> neighbours(const face_key& fid) const
+        {
+            const SimplexSet<node_key>& nids = nodes(fid);
+            SimplexSet<face_key> fids;
+            for (unsigned int i = 0; i < nids.size(); i++)
+            {
+                fids += faces(nids[i]) & faces(nids[(i+1)%nids.size()]);
+            }
+            return fids - fid;
+        }
+    };
+}
@@ -20,6 +20,13 @@
 #include "kernel.h"
 #include "simplex.h"
 #include "simplex_set.h"
+#include "thread_pool.h"
+#include "scheduler.h"
+#include "spatial_grid.h"
+#include "paged_array.h"
+#include "interface_surface.h"
+#include "field.h"
+#include "op_log.h"
 
 namespace is_mesh {
 
@@ -110,6 +117,90 @@ namespace is_mesh {
         kernel<face_type, FaceKey>*                  m_face_kernel;
         kernel<tetrahedron_type, TetrahedronKey>*           m_tetrahedron_kernel;
         
+        ThreadPool* m_thread_pool;
+        
+        // The nodes touched since the last validity check, see local_validity_check(). They are only recorded in debug
+        // builds or when enabled by track_touched_nodes().
+        std::vector<NodeKey> m_touched_nodes;
+        bool m_touched_overflow = false;
+#ifdef DEBUG
+        bool m_track_touched_nodes = true;
+#else
+        bool m_track_touched_nodes = false;
+#endif
+        
+        PagedArray<NodeKey> m_edited_nodes;
+        bool m_track_edited_nodes = false;
+        
+        SpatialGrid<NodeKey> m_node_grid;
+        unsigned int m_no_grid_edits = 0;
+        
+        FieldRegistry<NodeKey> m_node_fields;
+        FieldRegistry<EdgeKey> m_edge_fields;
+        FieldRegistry<FaceKey> m_face_fields;
+        FieldRegistry<TetrahedronKey> m_tet_fields;
+        
+        struct tet_contribution
+        {
+            real volume = 0.;
+            int label = -1;
+        };
+        struct face_contribution
+        {
+            real area = 0.;
+            int labels[2] = {-1, -1};
+        };
+        PagedArray<tet_contribution> m_tet_contributions;
+        PagedArray<face_contribution> m_face_contributions;
+        std::vector<real> m_label_volumes;
+        std::vector<real> m_label_areas;
+        std::vector<unsigned int> m_label_no_tets;
+        
+        // The cached quality of each tetrahedron and face, or a negative value if it has to be recomputed.
+        PagedArray<real> m_tet_qualities;
+        PagedArray<real> m_face_qualities;
+        
+        InterfaceSurface<NodeKey, FaceKey> m_interface;
+        
+        /**
+         * The nodes of an interface or boundary face in counter clockwise order seen from the tetrahedron tid.
+         */
+        struct sorted_face
+        {
+            NodeKey nids[3];
+            TetrahedronKey tid;
+        };
+        PagedArray<sorted_face> m_sorted_faces;
+        
+        // The query which last visited each simplex, see visit(). The stamps are kept between queries, such that a query does
+        // not have to clear arrays of the size of the mesh. They are not copied with the mesh.
+        std::vector<unsigned int> m_node_stamps;
+        std::vector<unsigned int> m_edge_stamps;
+        std::vector<unsigned int> m_face_stamps;
+        std::vector<unsigned int> m_tet_stamps;
+        unsigned int m_stamp = 0;
+        
+        OpLog* m_op_log = nullptr;
+        unsigned int m_op_depth = 0;
+        
+        /**
+         * Marks the scope of a recorded operation, such that the operations it calls internally are not recorded.
+         */
+        struct op_scope
+        {
+            unsigned int& depth;
+            op_scope(unsigned int& depth_) : depth(depth_) { depth++; }
+            ~op_scope() { depth--; }
+        };
+        
+        /**
+         * Returns the log to record an operation in, or nullptr if nothing should be recorded.
+         */
+        OpLog* recorder()
+        {
+            return m_op_depth == 0 ? m_op_log : nullptr;
+        }
+        
     public:
         ISMesh(std::vector<vec3> & points, std::vector<int> & tets, const std::vector<int>& tet_labels)
         {
@@ -117,38 +208,86 @@ namespace is_mesh {
             m_edge_kernel = new kernel<edge_type, EdgeKey>();
             m_face_kernel = new kernel<face_type, FaceKey>();
             m_tetrahedron_kernel = new kernel<tetrahedron_type, TetrahedronKey>();
+            m_thread_pool = new ThreadPool();
             
             create(points, tets);
             init_flags(tet_labels);
             validity_check();
         }
         
+        /**
+         * Creates a snapshot of the mesh. The kernels, the user fields, the statistics, the quality cache and the interface
+         * surface of the snapshot share their pages with the mesh, and a page is only copied when either writes to it
+         * (copy-on-write). Creating a snapshot therefore costs in the number of pages, which is the size of the mesh divided
+         * by the page size, and the snapshot can be read (or rendered, logged or exported) on another thread while the
+         * original mesh is deformed. The snapshot uses a single thread, see set_no_threads().
+         */
+        ISMesh(const ISMesh& mesh) :
+            m_edited_nodes(mesh.m_edited_nodes), m_track_edited_nodes(mesh.m_track_edited_nodes),
+            m_node_fields(mesh.m_node_fields), m_edge_fields(mesh.m_edge_fields), m_face_fields(mesh.m_face_fields), m_tet_fields(mesh.m_tet_fields),
+            m_tet_contributions(mesh.m_tet_contributions), m_face_contributions(mesh.m_face_contributions),
+            m_label_volumes(mesh.m_label_volumes), m_label_areas(mesh.m_label_areas), m_label_no_tets(mesh.m_label_no_tets),
+            m_tet_qualities(mesh.m_tet_qualities), m_face_qualities(mesh.m_face_qualities), m_interface(mesh.m_interface), m_sorted_faces(mesh.m_sorted_faces)
+        {
+            m_node_kernel = new kernel<node_type, NodeKey>(*mesh.m_node_kernel);
+            m_edge_kernel = new kernel<edge_type, EdgeKey>(*mesh.m_edge_kernel);
+            m_face_kernel = new kernel<face_type, FaceKey>(*mesh.m_face_kernel);
+            m_tetrahedron_kernel = new kernel<tetrahedron_type, TetrahedronKey>(*mesh.m_tetrahedron_kernel);
+            m_thread_pool = new ThreadPool(1);
+        }
+        
+        ISMesh& operator=(const ISMesh&) = delete;
+        
+        /**
+         * Copies the memory shared with snapshots of the mesh, such that neither this mesh nor the snapshots pay for the
+         * copying during later edits.
+         */
+        void detach()
+        {
+            m_node_kernel->detach();
+            m_edge_kernel->detach();
+            m_face_kernel->detach();
+            m_tetrahedron_kernel->detach();
+            m_edited_nodes.detach();
+            m_node_fields.detach();
+            m_edge_fields.detach();
+            m_face_fields.detach();
+            m_tet_fields.detach();
+            m_tet_contributions.detach();
+            m_face_contributions.detach();
+            m_tet_qualities.detach();
+            m_face_qualities.detach();
+            m_interface.detach();
+            m_sorted_faces.detach();
+        }
+        
         ~ISMesh()
         {
+            delete m_thread_pool;
             delete m_tetrahedron_kernel;
             delete m_face_kernel;
             delete m_edge_kernel;
             delete m_node_kernel;
         }
         
-        unsigned int get_no_nodes() const
+        size_t get_no_nodes() const
         {
-            return static_cast<unsigned int>(m_node_kernel->size());
+            return m_node_kernel->size();
         }
         
-        unsigned int get_no_edges() const
+        size_t get_no_edges() const
         {
-            return static_cast<unsigned int>(m_edge_kernel->size());
+            return m_edge_kernel->size();
         }
         
-        unsigned int get_no_faces() const
+        size_t get_no_faces() const
         {
-            return static_cast<unsigned int>(m_face_kernel->size());
+            return m_face_kernel->size();
         }
         
-        unsigned int get_no_tets() const
+        size_t get_no_tets() const
         {
-            return static_cast<unsigned int>(m_tetrahedron_kernel->size());
+            return m_tetrahedron_kernel->size();
         }
         
         ///////////////
@@ -218,7 +357,7 @@ namespace is_mesh {
         
         int get_label(const TetrahedronKey& t)
         {
-            return get(t).label();
+            return read(t).label();
         }
         
     private:
@@ -243,11 +382,73 @@ namespace is_mesh {
     public:
         void set_label(const TetrahedronKey& tid, int label)
         {
+            if(OpLog* log = recorder())
+            {
+                log->record(OpLog::SET_LABEL, tid, label);
+            }
+            op_scope scope(m_op_depth);
             get(tid).label(label);
             SimplexSet<TetrahedronKey> tids = {tid};
             update(tids);
         }
         
+        /**
+         * Sets the label of the tetrahedra tids[i] to labels[i]. Unlike calling set_label() for each tetrahedron, the flags
+         * of the faces, edges and nodes in the closure of the relabeled tetrahedra are updated only once.
+         */
+        void set_labels(const std::vector<TetrahedronKey>& tids, const std::vector<int>& labels)
+        {
+            assert(tids.size() == labels.size());
+            OpLog* log = recorder();
+            op_scope scope(m_op_depth);
+            std::vector<TetrahedronKey> changed;
+            for (unsigned int i = 0; i < tids.size(); i++)
+            {
+                if(get_label(tids[i]) != labels[i])
+                {
+                    if(log)
+                    {
+                        log->record(OpLog::SET_LABEL, tids[i], labels[i]);
+                    }
+                    get(tids[i]).label(labels[i]);
+                    changed.push_back(tids[i]);
+                }
+            }
+            update(changed);
+        }
+        
+        /**
+         * Sets the label of all tetrahedra whose barycenter p satisfies is_inside(p) to label. The predicate is evaluated
+         * in parallel, so it must be safe to call from several threads at once.
+         */
+        template<typename predicate>
+        void set_labels_where(const predicate& is_inside, int label)
+        {
+            std::vector<TetrahedronKey> tids;
+            tids.reserve(get_no_tets());
+            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            {
+                tids.push_back(tit.key());
+            }
+            
+            std::vector<char> inside(tids.size(), 0);
+            m_thread_pool->parallel_for(0, tids.size(), [&](size_t i)
+            {
+                std::vector<vec3> verts = get_pos(get_nodes(tids[i]));
+                inside[i] = is_inside(Util::barycenter(verts[0], verts[1], verts[2], verts[3]));
+            });
+            
+            std::vector<TetrahedronKey> relabel;
+            for (unsigned int i = 0; i < tids.size(); i++)
+            {
+                if(inside[i])
+                {
+                    relabel.push_back(tids[i]);
+                }
+            }
+            set_labels(relabel, std::vector<int>(relabel.size(), label));
+        }
+        
     private:
 
         struct edge_key {
@@ -369,6 +570,8 @@ namespace is_mesh {
             {
                 update_flag(nit.key());
             }
+            
+            recompute_statistics();
         }
         
         /**
@@ -376,6 +579,14 @@ namespace is_mesh {
          */
         void update(const SimplexSet<TetrahedronKey>& tids)
         {
+            for (auto t : tids)
+            {
+                if (exists(t))
+                {
+                    update_statistics(t);
+                }
+            }
+            
             // Update faces
             SimplexSet<FaceKey> fids = get_faces(tids);
             for (auto f : fids)
@@ -403,10 +614,141 @@ namespace is_mesh {
                 if (exists(n))
                 {
                     update_flag(n);
+                    touch(n);
+                }
+            }
+        }
+        
+        /**
+         * Updates the flags of the simplices in the closure of the tetrahedra tids. Each face, edge and node is updated once,
+         * also when it is shared by many of the tetrahedra.
+         */
+        void update(const std::vector<TetrahedronKey>& tids)
+        {
+            std::vector<FaceKey> fids;
+            std::vector<char> visited(m_face_kernel->capacity(), 0);
+            for (auto t : tids)
+            {
+                update_statistics(t);
+                for (auto f : get_faces(t))
+                {
+                    if(!visited[f])
+                    {
+                        visited[f] = 1;
+                        fids.push_back(f);
+                    }
+                }
+            }
+            for (auto f : fids)
+            {
+                update_flag(f);
+            }
+            
+            std::vector<EdgeKey> eids;
+            visited.assign(m_edge_kernel->capacity(), 0);
+            for (auto f : fids)
+            {
+                for (auto e : get_edges(f))
+                {
+                    if(!visited[e])
+                    {
+                        visited[e] = 1;
+                        eids.push_back(e);
+                    }
+                }
+            }
+            for (auto e : eids)
+            {
+                update_flag(e);
+            }
+            
+            std::vector<NodeKey> nids;
+            visited.assign(m_node_kernel->capacity(), 0);
+            for (auto e : eids)
+            {
+                for (auto n : get_nodes(e))
+                {
+                    if(!visited[n])
+                    {
+                        visited[n] = 1;
+                        nids.push_back(n);
+                    }
                 }
             }
+            for (auto n : nids)
+            {
+                update_flag(n);
+                touch(n);
+            }
+        }
+        
+        /**
+         * Records that the star of the node nid has been edited, such that it is verified by the next local_validity_check().
+         * If more nodes are touched than there are nodes in the mesh, the next check is a full check instead.
+         */
+        void touch(const NodeKey& nid)
+        {
+            m_no_grid_edits++;
+            if(m_track_touched_nodes)
+            {
+                if(m_touched_nodes.size() < m_node_kernel->size())
+                {
+                    m_touched_nodes.push_back(nid);
+                }
+                else {
+                    m_touched_overflow = true;
+                }
+            }
+            if(m_track_edited_nodes)
+            {
+                m_edited_nodes.push_back(nid);
+            }
+        }
+        
+    public:
+        /**
+         * Starts or stops recording the nodes touched by edits for local_validity_check(). Recording is on by default in
+         * debug builds only. While it is off, local_validity_check() checks the whole complex.
+         */
+        void track_touched_nodes(bool track)
+        {
+            if(track && !m_track_touched_nodes)
+            {
+                // The edits made while nothing was recorded are only covered by a full check.
+                m_touched_overflow = true;
+            }
+            m_track_touched_nodes = track;
+            if(!track)
+            {
+                std::vector<NodeKey>().swap(m_touched_nodes);
+            }
+        }
+        
+        /**
+         * Starts or pauses recording the nodes whose stars are edited or moved, see take_edited_nodes().
+         */
+        void track_edited_nodes(bool track)
+        {
+            m_track_edited_nodes = track;
+        }
+        
+        bool is_tracking_edited_nodes() const
+        {
+            return m_track_edited_nodes;
+        }
+        
+        /**
+         * Returns the nodes whose stars have been edited or moved since the last call, and starts a new record. The nodes
+         * may contain duplicates and nodes which have since been removed.
+         */
+        std::vector<NodeKey> take_edited_nodes()
+        {
+            std::vector<NodeKey> nids(m_edited_nodes.begin(), m_edited_nodes.end());
+            m_edited_nodes.clear();
+            return nids;
         }
         
+    private:
         void update_flag(const FaceKey & f)
         {
             set_interface(f, false);
@@ -430,6 +772,70 @@ namespace is_mesh {
                     set_interface(f, true);
                 }
             }
+            update_statistics(f);
+            update_interface_surface(f);
+            update_sorted_nodes(f);
+        }
+        
+        /**
+         * Inserts the face fid in the interface surface if it is interface and removes it otherwise. Must be called whenever
+         * the flags or the nodes of fid change.
+         */
+        void update_interface_surface(const FaceKey& fid)
+        {
+            if(read(fid).is_interface())
+            {
+                m_interface.insert(fid, get_nodes(fid));
+            }
+            else {
+                m_interface.erase(fid);
+            }
+        }
+        
+        /**
+         * Caches the oriented nodes of the face fid if it is interface or boundary, see get_sorted_nodes(). Must be called
+         * whenever the flags, the nodes or the tetrahedra of fid change. The orientation stays valid when nodes are moved,
+         * since a valid complex never contains inverted tetrahedra.
+         */
+        void update_sorted_nodes(const FaceKey& fid)
+        {
+            if(static_cast<size_t>(fid) >= m_sorted_faces.size())
+            {
+                m_sorted_faces.resize(std::max(static_cast<size_t>(fid) + 1, 2*m_sorted_faces.size()));
+            }
+            sorted_face& sf = m_sorted_faces.write(fid);
+            sf = sorted_face();
+            
+            TetrahedronKey tid;
+            if (read(fid).is_interface())
+            {
+                int label = -100;
+                for (auto t : get_tets(fid))
+                {
+                    int tl = get_label(t);
+                    if (tl > label)
+                    {
+                        label = tl;
+                        tid = t;
+                    }
+                }
+            }
+            else if (read(fid).is_boundary())
+            {
+                tid = get_tets(fid).front();
+            }
+            else {
+                return;
+            }
+            
+            SimplexSet<NodeKey> nids = get_nodes(fid);
+            NodeKey apex = (get_nodes(tid) - nids).front();
+            orient_cc(apex, nids);
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                sf.nids[i] = nids[i];
+            }
+            sf.tid = tid;
         }
         
         void update_flag(const EdgeKey & e)
@@ -552,69 +958,103 @@ namespace is_mesh {
             return m_tetrahedron_kernel->find(tid);
         }
         
+        /**
+         * Returns the node nid for reading. Unlike get(), this never copies memory shared with a snapshot of the mesh,
+         * so it is safe to use from several threads at once while the mesh is not modified.
+         */
+        const node_type & read(const NodeKey& nid) const
+        {
+            return m_node_kernel->find_const(nid);
+        }
+        
+        const edge_type & read(const EdgeKey& eid) const
+        {
+            return m_edge_kernel->find_const(eid);
+        }
+        
+        const face_type & read(const FaceKey& fid) const
+        {
+            return m_face_kernel->find_const(fid);
+        }
+        
+        const tetrahedron_type & read(const TetrahedronKey& tid) const
+        {
+            return m_tetrahedron_kernel->find_const(tid);
+        }
+        
         // Getters for getting the boundary/coboundary of a simplex:
         const SimplexSet<NodeKey>& get_nodes(const EdgeKey& eid)
         {
-            return get(eid).get_boundary();
+            return read(eid).get_boundary();
         }
         
         const SimplexSet<EdgeKey>& get_edges(const NodeKey& nid)
         {
-            return get(nid).get_co_boundary();
+            return read(nid).get_co_boundary();
         }
         
         const SimplexSet<EdgeKey>& get_edges(const FaceKey& fid)
         {
-            return get(fid).get_boundary();
+            return read(fid).get_boundary();
         }
         
         const SimplexSet<FaceKey>& get_faces(const EdgeKey& eid)
         {
-            return get(eid).get_co_boundary();
+            return read(eid).get_co_boundary();
         }
         
         const SimplexSet<FaceKey>& get_faces(const TetrahedronKey& tid)
         {
-            return get(tid).get_boundary();
+            return read(tid).get_boundary();
         }
         
         const SimplexSet<TetrahedronKey>& get_tets(const FaceKey& fid)
         {
-            return get(fid).get_co_boundary();
+            return read(fid).get_co_boundary();
         }
         
         // Getters for getting the boundary of a boundary etc.
         
+        /**
+         * Returns the nodes of the face fid in counter clockwise order seen from the tetrahedron tid. The order is cached for
+         * interface and boundary faces.
+         */
         SimplexSet<NodeKey> get_sorted_nodes(const FaceKey& fid, const TetrahedronKey& tid)
         {
+            if(static_cast<size_t>(fid) < m_sorted_faces.size() && m_sorted_faces[fid].tid.is_valid())
+            {
+                const sorted_face& sf = m_sorted_faces[fid];
+                if(sf.tid == tid)
+                {
+                    return {sf.nids[0], sf.nids[1], sf.nids[2]};
+                }
+                if(get_tets(fid).contains(tid))
+                {
+                    // Seen from the other side, the order is reversed
+                    return {sf.nids[1], sf.nids[0], sf.nids[2]};
+                }
+            }
             SimplexSet<NodeKey> nids = get_nodes(fid);
             NodeKey apex = (get_nodes(tid) - nids).front();
             orient_cc(apex, nids);
             return nids;
         }
         
+        /**
+         * Returns the nodes of the face fid. If fid is interface, they are in counter clockwise order seen from the adjacent
+         * tetrahedron with the largest label, and if fid is boundary, seen from its tetrahedron. The order is cached, so this
+         * does not depend on the positions of the nodes and is safe to call from several threads at once.
+         */
         SimplexSet<NodeKey> get_sorted_nodes(const FaceKey& fid)
         {
-            if (get(fid).is_interface())
-            {
-                int label = -100;
-                TetrahedronKey tid;
-                for (auto t : get_tets(fid))
-                {
-                    int tl = get_label(t);
-                    if (tl > label)
-                    {
-                        label = tl;
-                        tid = t;
-                    }
-                }
-                return get_sorted_nodes(fid, tid);
-            }
-            else if (get(fid).is_boundary())
+            if(static_cast<size_t>(fid) < m_sorted_faces.size() && m_sorted_faces[fid].tid.is_valid())
             {
-                TetrahedronKey tid = get_tets(fid).front();
-                return get_sorted_nodes(fid, tid);
+                const sorted_face& sf = m_sorted_faces[fid];
+                return {sf.nids[0], sf.nids[1], sf.nids[2]};
             }
+#ifdef DEBUG
+            assert(!read(fid).is_interface() && !read(fid).is_boundary());
+#endif
             return get_nodes(fid);
         }
         
@@ -722,38 +1162,153 @@ namespace is_mesh {
             return tids;
         }
         
-        // Other getter functions
+        // Getters for the neighbourhood of a set of nodes
+        
+    private:
         
         /**
-         *  Returns the node shared by the edges eid1 and eid2.
+         * Starts a new neighbourhood query, such that no simplex is marked as visited by it, see visit().
          */
-        NodeKey get_node(const EdgeKey& eid1, const EdgeKey& eid2)
+        void next_stamp()
         {
-            const SimplexSet<NodeKey>& nids = get_nodes(eid2);
-            for (const NodeKey& n : get_nodes(eid1)) {
-                if(nids.contains(n))
-                {
-                    return n;
-                }
+            if(++m_stamp == 0)
+            {
+                std::fill(m_node_stamps.begin(), m_node_stamps.end(), 0);
+                std::fill(m_edge_stamps.begin(), m_edge_stamps.end(), 0);
+                std::fill(m_face_stamps.begin(), m_face_stamps.end(), 0);
+                std::fill(m_tet_stamps.begin(), m_tet_stamps.end(), 0);
+                m_stamp = 1;
             }
-            return NodeKey();
         }
         
         /**
-         *  Returns the node adjacent to edge eid which is not nid.
+         * Marks the key k as visited by the current neighbourhood query and returns whether it was not visited before.
          */
-        NodeKey get_node(const EdgeKey& eid, const NodeKey& nid)
+        template<typename key_type>
+        bool visit(std::vector<unsigned int>& stamps, const key_type& k)
         {
-            const SimplexSet<NodeKey>& nids = get_nodes(eid);
-            if(nids[0] == nid)
+            if(static_cast<size_t>(k) >= stamps.size())
             {
-                return nids[1];
+                stamps.resize(std::max(static_cast<size_t>(k) + 1, 2*stamps.size()), 0);
             }
-            return nids[0];
+            if(stamps[k] == m_stamp)
+            {
+                return false;
+            }
+            stamps[k] = m_stamp;
+            return true;
         }
         
+    public:
+        
         /**
-         *  Returns the edge between the nodes nid1 and nid2.
+         * Returns the existing nodes among nids and the nodes connected to them by a path of at most k edges, each once and
+         * in the order they are met. The cost is in the size of the rings and not in the size of the mesh.
+         */
+        std::vector<NodeKey> get_k_ring(const std::vector<NodeKey>& nids, unsigned int k)
+        {
+            next_stamp();
+            std::vector<NodeKey> ring;
+            for (auto n : nids)
+            {
+                if(exists(n) && visit(m_node_stamps, n))
+                {
+                    ring.push_back(n);
+                }
+            }
+            size_t begin = 0;
+            for (unsigned int i = 0; i < k; i++)
+            {
+                size_t end = ring.size();
+                for (size_t j = begin; j < end; j++)
+                {
+                    for (auto e : get_edges(ring[j]))
+                    {
+                        for (auto n : get_nodes(e))
+                        {
+                            if(visit(m_node_stamps, n))
+                            {
+                                ring.push_back(n);
+                            }
+                        }
+                    }
+                }
+                begin = end;
+            }
+            return ring;
+        }
+        
+        /**
+         * Appends the edges, faces and tetrahedra incident to the existing nodes among nids to eids, fids and tids, each once and
+         * in the order they are met. The cost is in the size of the stars and not in the size of the mesh.
+         */
+        void get_stars(const std::vector<NodeKey>& nids, std::vector<EdgeKey>& eids, std::vector<FaceKey>& fids, std::vector<TetrahedronKey>& tids)
+        {
+            next_stamp();
+            for (auto n : nids)
+            {
+                if(!exists(n))
+                {
+                    continue;
+                }
+                for (auto e : get_edges(n))
+                {
+                    if(!visit(m_edge_stamps, e))
+                    {
+                        continue;
+                    }
+                    eids.push_back(e);
+                    for (auto f : get_faces(e))
+                    {
+                        if(!visit(m_face_stamps, f))
+                        {
+                            continue;
+                        }
+                        fids.push_back(f);
+                        for (auto t : get_tets(f))
+                        {
+                            if(visit(m_tet_stamps, t))
+                            {
+                                tids.push_back(t);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        
+        // Other getter functions
+        
+        /**
+         *  Returns the node shared by the edges eid1 and eid2.
+         */
+        NodeKey get_node(const EdgeKey& eid1, const EdgeKey& eid2)
+        {
+            const SimplexSet<NodeKey>& nids = get_nodes(eid2);
+            for (const NodeKey& n : get_nodes(eid1)) {
+                if(nids.contains(n))
+                {
+                    return n;
+                }
+            }
+            return NodeKey();
+        }
+        
+        /**
+         *  Returns the node adjacent to edge eid which is not nid.
+         */
+        NodeKey get_node(const EdgeKey& eid, const NodeKey& nid)
+        {
+            const SimplexSet<NodeKey>& nids = get_nodes(eid);
+            if(nids[0] == nid)
+            {
+                return nids[1];
+            }
+            return nids[0];
+        }
+        
+        /**
+         *  Returns the edge between the nodes nid1 and nid2.
          */
         EdgeKey get_edge(const NodeKey& nid1, const NodeKey& nid2)
         {
@@ -828,12 +1383,37 @@ namespace is_mesh {
             return TetrahedronKey();
         }
         
+        /**
+         * Returns the interface surface, i.e. the interface faces and their adjacency. It is kept up to date by the mesh,
+         * so surface queries run at the cost of the surface instead of the volume.
+         */
+        const InterfaceSurface<NodeKey, FaceKey>& get_interface_surface() const
+        {
+            return m_interface;
+        }
+        
+        /**
+         * Returns all interface faces.
+         */
+        const PagedArray<FaceKey>& get_interface_faces() const
+        {
+            return m_interface.faces();
+        }
+        
+        /**
+         * Returns the interface faces incident to the node nid.
+         */
+        const SimplexSet<FaceKey>& get_interface_faces(const NodeKey& nid) const
+        {
+            return m_interface.faces(nid);
+        }
+        
         /**
          * Returns the position of node nid.
          */
         vec3 get_pos(const NodeKey& nid)
         {
-            return get(nid).get_pos();
+            return read(nid).get_pos();
         }
         
         /**
@@ -894,9 +1474,9 @@ namespace is_mesh {
     public:
         bool is_clockwise_order(const NodeKey& nid, SimplexSet<NodeKey>& nids)
         {
-            auto x = get(nid).get_pos() - get(nids[0]).get_pos();
-            auto y = get(nids[1]).get_pos() - get(nids[0]).get_pos();
-            auto z = get(nids[2]).get_pos() - get(nids[0]).get_pos();
+            auto x = get_pos(nid) - get_pos(nids[0]);
+            auto y = get_pos(nids[1]) - get_pos(nids[0]);
+            auto z = get_pos(nids[2]) - get_pos(nids[0]);
             auto val = dot(x, cross(y,z));
             
             return val > 0.;
@@ -963,6 +1543,27 @@ namespace is_mesh {
         ////////////////////
     
     public:
+        /**
+         * Sets the position of the node nid.
+         */
+        void set_pos(const NodeKey& nid, const vec3& p)
+        {
+            if(OpLog* log = recorder())
+            {
+                log->record(OpLog::SET_POS, nid, p);
+            }
+            get(nid).set_pos(p);
+            touch(nid);
+            for (auto t : get_tets(nid))
+            {
+                update_statistics(t);
+            }
+            for (auto f : get_faces(nid))
+            {
+                update_statistics(f);
+            }
+        }
+        
         /**
          * Inserts a node into the mesh. Trivial.
          */
@@ -970,6 +1571,7 @@ namespace is_mesh {
         NodeKey insert_node(const vec3& p)
         {
             auto node = m_node_kernel->create(node_traits(p));
+            m_node_fields.insert(node.key());
             return node.key();
         }
         
@@ -980,6 +1582,7 @@ namespace is_mesh {
         EdgeKey insert_edge(NodeKey node1, NodeKey node2)
         {
             auto edge = m_edge_kernel->create(edge_traits());
+            m_edge_fields.insert(edge.key());
             //add the new simplex to the co-boundary relation of the boundary simplices
             get(node1).add_co_face(edge.key());
             get(node2).add_co_face(edge.key());
@@ -996,6 +1599,7 @@ namespace is_mesh {
         FaceKey insert_face(EdgeKey edge1, EdgeKey edge2, EdgeKey edge3)
         {
             auto face = m_face_kernel->create(face_traits());
+            m_face_fields.insert(face.key());
             //update relations
             get(edge1).add_co_face(face.key());
             get(edge2).add_co_face(face.key());
@@ -1013,6 +1617,7 @@ namespace is_mesh {
         TetrahedronKey insert_tetrahedron(FaceKey face1, FaceKey face2, FaceKey face3, FaceKey face4)
         {
             auto tetrahedron = m_tetrahedron_kernel->create(tet_traits());
+            m_tet_fields.insert(tetrahedron.key());
             //update relations
             get(face1).add_co_face(tetrahedron.key());
             get(face2).add_co_face(tetrahedron.key());
@@ -1068,6 +1673,13 @@ namespace is_mesh {
             {
                 get(e).remove_co_face(fid);
             }
+            subtract_statistics(fid);
+            invalidate_quality(fid);
+            m_interface.erase(fid);
+            if(static_cast<size_t>(fid) < m_sorted_faces.size())
+            {
+                m_sorted_faces.write(fid) = sorted_face();
+            }
             m_face_kernel->erase(fid);
         }
         
@@ -1080,6 +1692,8 @@ namespace is_mesh {
             {
                 get(f).remove_co_face(tid);
             }
+            subtract_statistics(tid);
+            invalidate_quality(tid);
             m_tetrahedron_kernel->erase(tid);
         }
         
@@ -1134,6 +1748,7 @@ namespace is_mesh {
         template<typename key_type>
         key_type merge(const key_type& key1, const key_type& key2)
         {
+            get_fields(key1).transfer(key1, {key1, key2});
             auto& simplex = get(key2);
             for(auto k : simplex.get_co_boundary())
             {
@@ -1156,6 +1771,11 @@ namespace is_mesh {
         
         void split(const EdgeKey& eid, const vec3& pos, const vec3& destination)
         {
+            if(OpLog* log = recorder())
+            {
+                log->record(OpLog::SPLIT, eid, pos, destination);
+            }
+            op_scope scope(m_op_depth);
             auto nids = get_nodes(eid);
             auto fids = get_faces(eid);
             auto tids = get_tets(eid);
@@ -1163,11 +1783,14 @@ namespace is_mesh {
             // Split edge
             auto new_nid = insert_node(pos);
             get(new_nid).set_destination(destination);
+            real t = Util::length(pos - get_pos(nids[0]))/Util::length(get_pos(nids[1]) - get_pos(nids[0]));
+            m_node_fields.transfer(new_nid, nids, {1. - t, t});
             
             disconnect(nids[1], eid);
             connect(new_nid, eid);
             
             auto new_eid = insert_edge(new_nid, nids[1]);
+            m_edge_fields.transfer(new_eid, {eid});
             
             // Update faces, create faces
             for (auto f : fids)
@@ -1180,7 +1803,8 @@ namespace is_mesh {
                 EdgeKey new_f_eid = insert_edge(new_e_nids[0], new_e_nids[1]);
                 connect(new_f_eid, f);
                 
-                insert_face(f_eid, new_f_eid, new_eid);
+                FaceKey new_fid = insert_face(f_eid, new_f_eid, new_eid);
+                m_face_fields.transfer(new_fid, {f});
             }
             
             // Update tetrahedra, create tetrahedra
@@ -1197,7 +1821,9 @@ namespace is_mesh {
                 
                 SimplexSet<FaceKey> t_fids = get_faces(new_eid) & get_faces(get_edges(t_fid));
                 assert(t_fids.size() == 2);
-                new_tids += insert_tetrahedron(t_fids[0], t_fids[1], new_t_fid, t_fid);
+                TetrahedronKey new_tid = insert_tetrahedron(t_fids[0], t_fids[1], new_t_fid, t_fid);
+                m_tet_fields.transfer(new_tid, {t});
+                new_tids += new_tid;
             }
             
             // Update flags
@@ -1205,6 +1831,16 @@ namespace is_mesh {
             {
                 set_label(new_tids[i], get_label(tids[i]));
             }
+            for (auto t : tids)
+            {
+                update_statistics(t);
+            }
+            for (auto f : get_faces(tids))
+            {
+                update_statistics(f);
+                update_interface_surface(f);
+                update_sorted_nodes(f);
+            }
             
             update_split(new_nid, nids[0], nids[1]);
         }
@@ -1222,8 +1858,14 @@ namespace is_mesh {
          */
         void collapse(const EdgeKey& eid, const NodeKey& nid, real weight = 0.5)
         {
+            if(OpLog* log = recorder())
+            {
+                log->record(OpLog::COLLAPSE, eid, nid, weight);
+            }
+            op_scope scope(m_op_depth);
             NodeKey nid_remove = (get_nodes(eid) - nid).front();
             update_collapse(nid, nid_remove, weight);
+            m_node_fields.transfer(nid, {nid, nid_remove}, {1. - weight, weight});
             
             auto fids = get_faces(eid);
             auto tids = get_tets(eid);
@@ -1264,6 +1906,11 @@ namespace is_mesh {
         
         FaceKey flip_32(const EdgeKey& eid)
         {
+            if(OpLog* log = recorder())
+            {
+                log->record(OpLog::FLIP_32, eid);
+            }
+            op_scope scope(m_op_depth);
             SimplexSet<NodeKey> e_nids = get_nodes(eid);
             SimplexSet<FaceKey> e_fids = get_faces(eid);
 #ifdef DEBUG
@@ -1286,6 +1933,7 @@ namespace is_mesh {
             assert(f_eids.size() == 3);
 #endif
             FaceKey new_fid = insert_face(f_eids[0], f_eids[1], f_eids[2]);
+            m_face_fields.transfer(new_fid, e_fids);
             
             // Remove faces
             for(const FaceKey& f : e_fids)
@@ -1301,7 +1949,8 @@ namespace is_mesh {
 #ifdef DEBUG
                 assert(t_fids.size() == 3);
 #endif
-                insert_tetrahedron(t_fids[0], t_fids[1], t_fids[2], new_fid);
+                TetrahedronKey new_tid = insert_tetrahedron(t_fids[0], t_fids[1], t_fids[2], new_fid);
+                m_tet_fields.transfer(new_tid, e_tids);
             }
             
             // Remove tetrahedra
@@ -1322,6 +1971,11 @@ namespace is_mesh {
         
         EdgeKey flip_23(const FaceKey& fid)
         {
+            if(OpLog* log = recorder())
+            {
+                log->record(OpLog::FLIP_23, fid);
+            }
+            op_scope scope(m_op_depth);
             SimplexSet<TetrahedronKey> f_tids = get_tets(fid);
 #ifdef DEBUG
             assert(f_tids.size() == 2);
@@ -1354,7 +2008,8 @@ namespace is_mesh {
 #ifdef DEBUG
                 assert(new_f_eids.size() == 2);
 #endif
-                insert_face(new_f_eids[0], new_f_eids[1], new_eid);
+                FaceKey new_fid = insert_face(new_f_eids[0], new_f_eids[1], new_eid);
+                m_face_fields.transfer(new_fid, {fid});
             }
             
             // Remove face
@@ -1373,7 +2028,8 @@ namespace is_mesh {
 #ifdef DEBUG
                 assert(new_t_fids.size() == 4);
 #endif
-                insert_tetrahedron(new_t_fids[0], new_t_fids[1], new_t_fids[2], new_t_fids[3]);
+                TetrahedronKey new_tid = insert_tetrahedron(new_t_fids[0], new_t_fids[1], new_t_fids[2], new_t_fids[3]);
+                m_tet_fields.transfer(new_tid, f_tids);
             }
             
             // Remove tetrahedra
@@ -1393,6 +2049,11 @@ namespace is_mesh {
         
         void flip(const EdgeKey& eid, const FaceKey& fid1, const FaceKey& fid2)
         {
+            if(OpLog* log = recorder())
+            {
+                log->record(OpLog::FLIP, eid, fid1, fid2);
+            }
+            op_scope scope(m_op_depth);
             SimplexSet<FaceKey> fids = {fid1, fid2};
             SimplexSet<NodeKey> e_nids = get_nodes(eid);
             SimplexSet<FaceKey> e_fids = get_faces(eid);
@@ -1475,151 +2136,988 @@ namespace is_mesh {
             flip(eid[0], fid1, fid2);
         }
         
-        ///////////////////////
-        // UTILITY FUNCTIONS //
-        ///////////////////////
-    public:
+        //////////////////////////
+        // STATISTICS FUNCTIONS //
+        //////////////////////////
+    private:
         
-        void garbage_collect()
+        void add_to_label(int label, real volume, real area, int no_tets)
         {
-            m_node_kernel->garbage_collect();
-            m_edge_kernel->garbage_collect();
-            m_face_kernel->garbage_collect();
-            m_tetrahedron_kernel->garbage_collect();
+            assert(label >= 0);
+            if(label >= static_cast<int>(m_label_volumes.size()))
+            {
+                m_label_volumes.resize(label + 1, 0.);
+                m_label_areas.resize(label + 1, 0.);
+                m_label_no_tets.resize(label + 1, 0);
+            }
+            m_label_volumes[label] += volume;
+            m_label_areas[label] += area;
+            m_label_no_tets[label] += no_tets;
         }
         
-        virtual void scale(const vec3& s)
+        /**
+         * Removes the contribution of the tetrahedron tid from the statistics.
+         */
+        void subtract_statistics(const TetrahedronKey& tid)
         {
-            for (auto nit = nodes_begin(); nit != nodes_end(); nit++) {
-                nit->set_pos(s*nit->get_pos());
-                nit->set_destination(s*nit->get_destination());
+            if(static_cast<size_t>(tid) < m_tet_contributions.size() && m_tet_contributions[tid].label >= 0)
+            {
+                tet_contribution& c = m_tet_contributions.write(tid);
+                add_to_label(c.label, -c.volume, 0., -1);
+                c = tet_contribution();
             }
         }
         
-        void extract_surface_mesh(std::vector<vec3>& points, std::vector<int>& faces)
+        /**
+         * Removes the contribution of the face fid from the statistics.
+         */
+        void subtract_statistics(const FaceKey& fid)
         {
-            garbage_collect();
-            
-            std::map<NodeKey, int> indices;
-            // Extract vertices
-            for (auto nit = nodes_begin(); nit != nodes_end(); nit++)
-            {
-                if (nit->is_interface())
-                {
-                    points.push_back(nit->get_pos());
-                    indices[nit.key()] = static_cast<int>(points.size());
-                }
-            }
-            
-            // Extract faces
-            for (auto fit = faces_begin(); fit != faces_end(); fit++)
+            if(static_cast<size_t>(fid) < m_face_contributions.size())
             {
-                if (fit->is_interface())
+                face_contribution& c = m_face_contributions.write(fid);
+                for (auto l : c.labels)
                 {
-                    for (auto &n : get_sorted_nodes(fit.key()))
+                    if(l >= 0)
                     {
-                        faces.push_back(indices[n]);
+                        add_to_label(l, 0., -c.area, 0);
                     }
                 }
+                c = face_contribution();
             }
         }
         
-        void extract_tet_mesh(std::vector<vec3>& points, std::vector<int>& tets, std::vector<int>& tet_labels)
+        /**
+         * Marks the cached quality of the tetrahedron tid as outdated.
+         */
+        void invalidate_quality(const TetrahedronKey& tid)
         {
-            garbage_collect();
-            
-            std::map<NodeKey, int> indices;
-            // Extract vertices
-            for (auto nit = nodes_begin(); nit != nodes_end(); nit++)
+            if(static_cast<size_t>(tid) >= m_tet_qualities.size())
             {
-                indices[nit.key()] = static_cast<int>(points.size());
-                points.push_back(nit->get_pos());
+                m_tet_qualities.resize(std::max(static_cast<size_t>(tid) + 1, 2*m_tet_qualities.size()), -1.);
             }
-            
-            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            m_tet_qualities.write(tid) = -1.;
+        }
+        
+        /**
+         * Marks the cached quality of the face fid as outdated.
+         */
+        void invalidate_quality(const FaceKey& fid)
+        {
+            if(static_cast<size_t>(fid) >= m_face_qualities.size())
             {
-                for (auto n : get_nodes(tit.key()))
-                {
-                    tets.push_back(indices[n]);
-                }
-                tet_labels.push_back(get_label(tit.key()));
+                m_face_qualities.resize(std::max(static_cast<size_t>(fid) + 1, 2*m_face_qualities.size()), -1.);
             }
+            m_face_qualities.write(fid) = -1.;
         }
-                
-        void validity_check()
+        
+        /**
+         * Replaces the contribution of the tetrahedron tid to the statistics by its current volume and label.
+         */
+        void update_statistics(const TetrahedronKey& tid)
         {
-            std::cout << "Testing connectivity of simplicial complex: ";
-            for(auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            invalidate_quality(tid);
+            subtract_statistics(tid);
+            if(tid >= m_tet_contributions.size())
             {
-                assert(exists(tit.key()));
-                // Check faces:
-                auto faces = get_faces(tit.key());
-                assert(faces.size() == 4);
-                for (auto f : faces) {
-                    assert(exists(f));
-                    auto cotets = get_tets(f);
-                    assert((get(f).is_boundary() && cotets.size() == 1) || (!get(f).is_boundary() && cotets.size() == 2));
-                    assert(std::find(cotets.begin(), cotets.end(), tit.key()) != cotets.end());
-                    for (auto f2 : faces) {
-                        assert(f == f2 || get_edge(f, f2).is_valid());
-                    }
-                    
-                    // Check edges:
-                    auto edges = get_edges(f);
-                    assert(edges.size() == 3);
-                    for (auto e : edges)
-                    {
-                        assert(exists(e));
-                        auto cofaces = get_faces(e);
-                        assert(std::find(cofaces.begin(), cofaces.end(), f) != cofaces.end());
-                        for (auto e2 : edges) {
-                            assert(e == e2 || get_node(e, e2).is_valid());
-                        }
-                        
-                        // Check nodes:
-                        auto nodes = get_nodes(e);
-                        assert(nodes.size() == 2);
-                        for (auto n : nodes)
-                        {
-                            assert(exists(n));
-                            auto coedges = get_edges(n);
-                            assert(std::find(coedges.begin(), coedges.end(), e) != coedges.end());
-                        }
-                    }
-                    
-                }
-                
-                assert(get_edges(tit.key()).size() == 6);
-                assert(get_nodes(tit.key()).size() == 4);
+                m_tet_contributions.resize(std::max(static_cast<size_t>(tid) + 1, 2*m_tet_contributions.size()));
             }
-            std::cout << "PASSED" << std::endl;
-            
-            std::cout << "Testing for inverted tetrahedra: ";
+            tet_contribution& c = m_tet_contributions.write(tid);
+            std::vector<vec3> verts = get_pos(get_nodes(tid));
+            c.volume = Util::volume<real>(verts[0], verts[1], verts[2], verts[3]);
+            c.label = get_label(tid);
+            add_to_label(c.label, c.volume, 0., 1);
+        }
+        
+        /**
+         * Replaces the contribution of the face fid to the statistics. An interface face contributes its area to the labels
+         * of the tetrahedra on either side of it, except for label 0 on the boundary of the domain.
+         */
+        void update_statistics(const FaceKey& fid)
+        {
+            invalidate_quality(fid);
+            subtract_statistics(fid);
+            if(!get(fid).is_interface())
+            {
+                return;
+            }
+            if(fid >= m_face_contributions.size())
+            {
+                m_face_contributions.resize(std::max(static_cast<size_t>(fid) + 1, 2*m_face_contributions.size()));
+            }
+            face_contribution& c = m_face_contributions.write(fid);
+            std::vector<vec3> verts = get_pos(get_nodes(fid));
+            c.area = Util::area<real>(verts[0], verts[1], verts[2]);
+            const SimplexSet<TetrahedronKey>& tids = get_tets(fid);
+            for (unsigned int i = 0; i < tids.size(); i++)
+            {
+                c.labels[i] = get_label(tids[i]);
+                add_to_label(c.labels[i], 0., c.area, 0);
+            }
+        }
+        
+    public:
+        
+        /**
+         * Recomputes the per-label statistics from scratch. The statistics are otherwise maintained incrementally by the
+         * edit operations and set_pos, so this is only needed to remove accumulated round-off or after positions have been
+         * changed directly through the node attributes. It also discards the cached qualities.
+         */
+        void recompute_statistics()
+        {
+            m_tet_qualities.clear();
+            m_face_qualities.clear();
+            m_tet_contributions.clear();
+            m_face_contributions.clear();
+            m_label_volumes.clear();
+            m_label_areas.clear();
+            m_label_no_tets.clear();
             for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
             {
-                assert(!is_inverted(tit.key()));
+                update_statistics(tit.key());
             }
-            std::cout << "PASSED" << std::endl;
-            
-            std::cout << "Testing for corrupted interface or boundary: ";
-            for (auto eit = edges_begin(); eit != edges_end(); eit++)
+            for (auto fit = faces_begin(); fit != faces_end(); fit++)
             {
-                int boundary = 0;
-                int interface = 0;
-                for (auto f : get_faces(eit.key())) {
-                    if(get(f).is_boundary())
-                    {
-                        boundary++;
-                    }
-                    if(get(f).is_interface())
-                    {
-                        interface++;
-                    }
-                }
-                assert((eit->is_interface() && interface >= 2) || (!eit->is_interface() && interface == 0)); // Check that the interface is not corrupted
-                assert((eit->is_boundary() && boundary == 2) || (!eit->is_boundary() && boundary == 0)); // Check that the boundary is not corrupted
+                update_statistics(fit.key());
+            }
+        }
+        
+    protected:
+        /**
+         * Returns the cached quality of the tetrahedron tid, or a negative value if it has been edited or any of its nodes has
+         * been moved since the quality was cached. The mesh only invalidates the cache, the quality measure is up to the
+         * caller, see cache_quality().
+         */
+        real get_cached_quality(const TetrahedronKey& tid) const
+        {
+            return static_cast<size_t>(tid) < m_tet_qualities.size() ? m_tet_qualities[tid] : -1.;
+        }
+        
+        /**
+         * Returns the cached quality of the face fid, or a negative value if it has to be recomputed.
+         */
+        real get_cached_quality(const FaceKey& fid) const
+        {
+            return static_cast<size_t>(fid) < m_face_qualities.size() ? m_face_qualities[fid] : -1.;
+        }
+        
+        /**
+         * Caches the quality q of the tetrahedron tid until it is edited or moved. The quality is not cached while the page
+         * is shared with a snapshot, since the qualities are computed from several threads at once and copying the page is
+         * not thread safe.
+         */
+        void cache_quality(const TetrahedronKey& tid, real q)
+        {
+            if(static_cast<size_t>(tid) < m_tet_qualities.size() && !m_tet_qualities.is_shared(tid))
+            {
+                m_tet_qualities.write(tid) = q;
+            }
+        }
+        
+        /**
+         * Caches the quality q of the face fid until it is edited or moved, see cache_quality(const TetrahedronKey&, real).
+         */
+        void cache_quality(const FaceKey& fid, real q)
+        {
+            if(static_cast<size_t>(fid) < m_face_qualities.size() && !m_face_qualities.is_shared(fid))
+            {
+                m_face_qualities.write(fid) = q;
+            }
+        }
+        
+    public:
+        /**
+         * Returns the total volume of the tetrahedra with the given label.
+         */
+        real get_volume(int label) const
+        {
+            return label < static_cast<int>(m_label_volumes.size()) ? m_label_volumes[label] : 0.;
+        }
+        
+        /**
+         * Returns the area of the interface bounding the tetrahedra with the given label.
+         */
+        real get_interface_area(int label) const
+        {
+            return label < static_cast<int>(m_label_areas.size()) ? m_label_areas[label] : 0.;
+        }
+        
+        /**
+         * Returns the number of tetrahedra with the given label.
+         */
+        unsigned int get_no_tets(int label) const
+        {
+            return label < static_cast<int>(m_label_no_tets.size()) ? m_label_no_tets[label] : 0;
+        }
+        
+        /////////////////////
+        // FIELD FUNCTIONS //
+        /////////////////////
+    public:
+        
+        /**
+         * Returns the user fields on the nodes. A field stores one value per node in a separate array indexed by the node key,
+         * e.g. node_fields().add<real>("pressure") followed by node_fields().get<real>("pressure")[nid]. The values are
+         * transferred to new nodes by splits and collapses according to the transfer rule of the field.
+         */
+        FieldRegistry<NodeKey>& node_fields()
+        {
+            return m_node_fields;
+        }
+        
+        /**
+         * Returns the user fields on the edges. See node_fields().
+         */
+        FieldRegistry<EdgeKey>& edge_fields()
+        {
+            return m_edge_fields;
+        }
+        
+        /**
+         * Returns the user fields on the faces. See node_fields().
+         */
+        FieldRegistry<FaceKey>& face_fields()
+        {
+            return m_face_fields;
+        }
+        
+        /**
+         * Returns the user fields on the tetrahedra. See node_fields(). Tetrahedra created by a split inherit the values of
+         * the tetrahedron they were split from, while tetrahedra created by a flip get the average of the replaced tetrahedra.
+         */
+        FieldRegistry<TetrahedronKey>& tet_fields()
+        {
+            return m_tet_fields;
+        }
+        
+    private:
+        FieldRegistry<NodeKey>& get_fields(const NodeKey&)
+        {
+            return m_node_fields;
+        }
+        
+        FieldRegistry<EdgeKey>& get_fields(const EdgeKey&)
+        {
+            return m_edge_fields;
+        }
+        
+        FieldRegistry<FaceKey>& get_fields(const FaceKey&)
+        {
+            return m_face_fields;
+        }
+        
+        FieldRegistry<TetrahedronKey>& get_fields(const TetrahedronKey&)
+        {
+            return m_tet_fields;
+        }
+        
+        ////////////////////////
+        // PARALLEL FUNCTIONS //
+        ////////////////////////
+    public:
+        
+        /**
+         * Sets the number of threads (including the calling thread) used by the parallel functions.
+         */
+        void set_no_threads(unsigned int no_threads)
+        {
+            delete m_thread_pool;
+            m_thread_pool = new ThreadPool(no_threads);
+        }
+        
+        ThreadPool& get_thread_pool()
+        {
+            return *m_thread_pool;
+        }
+        
+        /**
+         * Partitions the nodes nids into batches such that no two nodes in the same batch share a tetrahedron, i.e. the stars
+         * of the nodes in a batch are disjoint. Use this for operations which only edit the star of a node, e.g. smoothing.
+         */
+        std::vector<std::vector<NodeKey>> independent_sets(const std::vector<NodeKey>& nids, Scheduler::Method method = Scheduler::GREEDY_COLORING)
+        {
+            std::vector<SimplexSet<TetrahedronKey>> regions(nids.size());
+            m_thread_pool->parallel_for(0, nids.size(), [&](size_t i)
+            {
+                regions[i] = get_tets(nids[i]);
+            });
+            return Scheduler(*m_thread_pool).independent_sets(nids, regions, method);
+        }
+        
+        /**
+         * Partitions the tetrahedra tids into batches such that the stars of the nodes of two tetrahedra in the same batch are disjoint.
+         * Use this for operations which edit the neighbourhood of a tetrahedron, e.g. edge or face removal.
+         */
+        std::vector<std::vector<TetrahedronKey>> independent_sets(const std::vector<TetrahedronKey>& tids, Scheduler::Method method = Scheduler::GREEDY_COLORING)
+        {
+            std::vector<SimplexSet<TetrahedronKey>> regions(tids.size());
+            m_thread_pool->parallel_for(0, tids.size(), [&](size_t i)
+            {
+                regions[i] = get_tets(get_nodes(tids[i]));
+            });
+            return Scheduler(*m_thread_pool).independent_sets(tids, regions, method);
+        }
+        
+        /**
+         * Applies f to each key in the batches. The batches are processed in order and the keys within a batch in parallel.
+         * The function f must not insert or remove simplices, since the kernels are not thread safe.
+         */
+        template<typename key_type, typename function>
+        void apply_independent(const std::vector<std::vector<key_type>>& batches, const function& f)
+        {
+            Scheduler(*m_thread_pool).apply(batches, f);
+        }
+        
+        //////////////////////////////
+        // POINT LOCATION FUNCTIONS //
+        //////////////////////////////
+    private:
+        
+        /**
+         * Rebuilds the grid of seed nodes used by locate() if it has not been built or if the mesh has been edited
+         * more than there are nodes since it was built. A slightly outdated grid only gives worse starting points.
+         */
+        void update_node_grid()
+        {
+            if(!m_node_grid.empty() && m_no_grid_edits <= get_no_nodes())
+            {
+                return;
+            }
+            std::vector<NodeKey> nids;
+            std::vector<vec3> points;
+            nids.reserve(get_no_nodes());
+            points.reserve(get_no_nodes());
+            for (auto nit = nodes_begin(); nit != nodes_end(); nit++)
+            {
+                nids.push_back(nit.key());
+                points.push_back(nit->get_pos());
+            }
+            m_node_grid.build(nids, points);
+            m_no_grid_edits = 0;
+        }
+        
+        /**
+         * Returns whether the point p is inside the tetrahedron tid and computes its barycentric coordinates.
+         */
+        bool is_inside(const TetrahedronKey& tid, const vec3& p, std::vector<real>& coords)
+        {
+            std::vector<vec3> verts = get_pos(get_nodes(tid));
+            coords = Util::barycentric_coords<real>(p, verts[0], verts[1], verts[2], verts[3]);
+            for (auto c : coords)
+            {
+                if(!(c >= -EPSILON))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        
+        /**
+         * Finds the tetrahedron containing p by checking every tetrahedron.
+         */
+        TetrahedronKey locate_brute_force(const vec3& p, std::vector<real>& coords)
+        {
+            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            {
+                if(is_inside(tit.key(), p, coords))
+                {
+                    return tit.key();
+                }
+            }
+            return TetrahedronKey();
+        }
+        
+        /**
+         * Finds the tetrahedron containing p by walking from a tetrahedron of a nearby node in the grid. In each step the
+         * walk moves across the face opposite the most negative barycentric coordinate. If the walk does not converge,
+         * e.g. due to degenerate tetrahedra, the tetrahedra are checked one by one. Does not modify the mesh.
+         */
+        TetrahedronKey locate_walk(const vec3& p, std::vector<real>& coords)
+        {
+            NodeKey seed;
+            real min_dist = INFINITY;
+            for (auto n : m_node_grid.candidates(p))
+            {
+                if(exists(n) && sqr_length(get_pos(n) - p) < min_dist)
+                {
+                    seed = n;
+                    min_dist = sqr_length(get_pos(n) - p);
+                }
+            }
+            if(!seed.is_valid() || get_tets(seed).size() == 0)
+            {
+                return locate_brute_force(p, coords);
+            }
+            
+            const unsigned int max_steps = 1000;
+            TetrahedronKey tid = get_tets(seed)[0];
+            for (unsigned int step = 0; step < max_steps; step++)
+            {
+                if(is_inside(tid, p, coords))
+                {
+                    return tid;
+                }
+                if(std::isnan(coords[0]))
+                {
+                    break;
+                }
+                
+                SimplexSet<NodeKey> nids = get_nodes(tid);
+                unsigned int i = static_cast<unsigned int>(std::min_element(coords.begin(), coords.end()) - coords.begin());
+                TetrahedronKey next;
+                for (auto f : get_faces(tid))
+                {
+                    if(!get_nodes(f).contains(nids[i]))
+                    {
+                        SimplexSet<TetrahedronKey> tids = get_tets(f) - tid;
+                        if(tids.size() == 0)
+                        {
+                            return TetrahedronKey(); // The walk left the complex through the boundary.
+                        }
+                        next = tids.front();
+                    }
+                }
+                tid = next;
+            }
+            return locate_brute_force(p, coords);
+        }
+        
+    public:
+        
+        /**
+         * Returns the tetrahedron containing the point p and stores the barycentric coordinates of p with respect to its
+         * nodes (in the order given by get_nodes()) in coords. Returns an invalid key if p is outside the complex.
+         */
+        TetrahedronKey locate(const vec3& p, std::vector<real>& coords)
+        {
+            update_node_grid();
+            return locate_walk(p, coords);
+        }
+        
+        /**
+         * Locates all the points in parallel. See locate().
+         */
+        std::vector<TetrahedronKey> locate(const std::vector<vec3>& points, std::vector<std::vector<real>>& coords)
+        {
+            update_node_grid();
+            std::vector<TetrahedronKey> tids(points.size());
+            coords.resize(points.size());
+            m_thread_pool->parallel_for(0, points.size(), [&](size_t i)
+            {
+                tids[i] = locate_walk(points[i], coords[i]);
+            }, 16);
+            return tids;
+        }
+        
+        /////////////////////////////////
+        // RECORD AND REPLAY FUNCTIONS //
+        /////////////////////////////////
+    public:
+        
+        /**
+         * Starts recording the operations performed on the mesh (splits, collapses, flips, set_pos, set_label, scale and
+         * garbage collection) in log. Pass nullptr to stop recording. The log must outlive the recording.
+         */
+        void record(OpLog* log)
+        {
+            m_op_log = log;
+        }
+        
+        /**
+         * Applies the operations in log to the mesh. The mesh must be in the same state as the mesh the log was recorded on
+         * was when the recording started, e.g. created from the same input. No decisions are made during a replay, so it
+         * runs at the speed of the mesh operations alone.
+         */
+        void replay(const OpLog& log)
+        {
+            OpLog::Reader reader(log);
+            while(!reader.done())
+            {
+                switch (reader.read_op()) {
+                    case OpLog::SPLIT:
+                    {
+                        EdgeKey eid = reader.read_key<EdgeKey>();
+                        vec3 pos = reader.read_vec3();
+                        vec3 destination = reader.read_vec3();
+                        split(eid, pos, destination);
+                        break;
+                    }
+                    case OpLog::COLLAPSE:
+                    {
+                        EdgeKey eid = reader.read_key<EdgeKey>();
+                        NodeKey nid = reader.read_key<NodeKey>();
+                        collapse(eid, nid, reader.read_real());
+                        break;
+                    }
+                    case OpLog::FLIP_23:
+                        flip_23(reader.read_key<FaceKey>());
+                        break;
+                    case OpLog::FLIP_32:
+                        flip_32(reader.read_key<EdgeKey>());
+                        break;
+                    case OpLog::FLIP:
+                    {
+                        EdgeKey eid = reader.read_key<EdgeKey>();
+                        FaceKey fid1 = reader.read_key<FaceKey>();
+                        FaceKey fid2 = reader.read_key<FaceKey>();
+                        flip(eid, fid1, fid2);
+                        break;
+                    }
+                    case OpLog::SET_POS:
+                    {
+                        NodeKey nid = reader.read_key<NodeKey>();
+                        set_pos(nid, reader.read_vec3());
+                        break;
+                    }
+                    case OpLog::SET_LABEL:
+                    {
+                        TetrahedronKey tid = reader.read_key<TetrahedronKey>();
+                        set_label(tid, reader.read_int());
+                        break;
+                    }
+                    case OpLog::SCALE:
+                        scale(reader.read_vec3());
+                        break;
+                    case OpLog::GARBAGE_COLLECT:
+                        garbage_collect();
+                        break;
+                    default:
+                        assert(!"Unknown operation in log");
+                        return;
+                }
+            }
+        }
+        
+        ///////////////////////
+        // UTILITY FUNCTIONS //
+        ///////////////////////
+    public:
+        
+        void garbage_collect()
+        {
+            if(OpLog* log = recorder())
+            {
+                log->record(OpLog::GARBAGE_COLLECT);
+            }
+            m_node_kernel->garbage_collect();
+            m_edge_kernel->garbage_collect();
+            m_face_kernel->garbage_collect();
+            m_tetrahedron_kernel->garbage_collect();
+        }
+        
+        /**
+         * Advises the operating system how the mesh is about to be accessed. Only has an effect if the kernels are memory
+         * mapped, see kernel::advise().
+         */
+        void advise(AccessPattern access)
+        {
+            m_node_kernel->advise(access);
+            m_edge_kernel->advise(access);
+            m_face_kernel->advise(access);
+            m_tetrahedron_kernel->advise(access);
+        }
+        
+        virtual void scale(const vec3& s)
+        {
+            if(OpLog* log = recorder())
+            {
+                log->record(OpLog::SCALE, s);
+            }
+            for (auto nit = nodes_begin(); nit != nodes_end(); nit++) {
+                nit->set_pos(s*nit->get_pos());
+                nit->set_destination(s*nit->get_destination());
+            }
+            recompute_statistics();
+        }
+        
+        /**
+         * Extracts the interface as a triangle mesh. The buffers points and faces are overwritten, so their memory is reused
+         * when the same buffers are passed every time step. The face indices refer to points and are zero based.
+         */
+        void extract_surface_mesh(std::vector<vec3>& points, std::vector<int>& faces)
+        {
+            garbage_collect();
+            advise(ACCESS_SEQUENTIAL);
+            
+            const size_t no_node_cells = m_node_kernel->capacity();
+            const size_t no_face_cells = m_face_kernel->capacity();
+            const unsigned int no_blocks = m_thread_pool->size();
+            std::vector<int> indices(no_node_cells, -1);
+            std::vector<size_t> offsets(no_blocks + 1, 0);
+            
+            // Extract vertices
+            m_thread_pool->parallel_blocks(no_node_cells, [&](unsigned int b, size_t begin, size_t end)
+            {
+                size_t n = 0;
+                for (size_t i = begin; i < end; i++)
+                {
+                    NodeKey nid(static_cast<key_value>(i));
+                    if (exists(nid) && read(nid).is_interface())
+                    {
+                        n++;
+                    }
+                }
+                offsets[b+1] = n;
+            });
+            for (unsigned int b = 0; b < no_blocks; b++)
+            {
+                offsets[b+1] += offsets[b];
+            }
+            points.resize(offsets[no_blocks]);
+            m_thread_pool->parallel_blocks(no_node_cells, [&](unsigned int b, size_t begin, size_t end)
+            {
+                size_t j = offsets[b];
+                for (size_t i = begin; i < end; i++)
+                {
+                    NodeKey nid(static_cast<key_value>(i));
+                    if (exists(nid) && read(nid).is_interface())
+                    {
+                        points[j] = read(nid).get_pos();
+                        indices[i] = static_cast<int>(j);
+                        j++;
+                    }
+                }
+            });
+            
+            // Extract faces
+            m_thread_pool->parallel_blocks(no_face_cells, [&](unsigned int b, size_t begin, size_t end)
+            {
+                size_t n = 0;
+                for (size_t i = begin; i < end; i++)
+                {
+                    FaceKey fid(static_cast<key_value>(i));
+                    if (exists(fid) && read(fid).is_interface())
+                    {
+                        n++;
+                    }
+                }
+                offsets[b+1] = n;
+            });
+            for (unsigned int b = 0; b < no_blocks; b++)
+            {
+                offsets[b+1] += offsets[b];
+            }
+            faces.resize(3*offsets[no_blocks]);
+            m_thread_pool->parallel_blocks(no_face_cells, [&](unsigned int b, size_t begin, size_t end)
+            {
+                size_t j = 3*offsets[b];
+                for (size_t i = begin; i < end; i++)
+                {
+                    FaceKey fid(static_cast<key_value>(i));
+                    if (exists(fid) && read(fid).is_interface())
+                    {
+                        for (auto &n : get_sorted_nodes(fid))
+                        {
+                            faces[j++] = indices[n];
+                        }
+                    }
+                }
+            });
+            advise(ACCESS_NORMAL);
+        }
+        
+        /**
+         * Extracts the tetrahedral mesh. The buffers are overwritten, so their memory is reused when the same buffers are passed
+         * every time step. The tetrahedron indices refer to points and are zero based.
+         */
+        void extract_tet_mesh(std::vector<vec3>& points, std::vector<int>& tets, std::vector<int>& tet_labels)
+        {
+            garbage_collect();
+            advise(ACCESS_SEQUENTIAL);
+            
+            const size_t no_node_cells = m_node_kernel->capacity();
+            const size_t no_tet_cells = m_tetrahedron_kernel->capacity();
+            const unsigned int no_blocks = m_thread_pool->size();
+            std::vector<int> indices(no_node_cells, -1);
+            std::vector<size_t> offsets(no_blocks + 1, 0);
+            
+            // Extract vertices. The free cells are the only holes, so the offset of each block follows from the free cells before it.
+            m_thread_pool->parallel_blocks(no_node_cells, [&](unsigned int b, size_t begin, size_t end)
+            {
+                size_t n = 0;
+                for (size_t i = begin; i < end; i++)
+                {
+                    if (exists(NodeKey(static_cast<key_value>(i))))
+                    {
+                        n++;
+                    }
+                }
+                offsets[b+1] = n;
+            });
+            for (unsigned int b = 0; b < no_blocks; b++)
+            {
+                offsets[b+1] += offsets[b];
+            }
+            points.resize(offsets[no_blocks]);
+            m_thread_pool->parallel_blocks(no_node_cells, [&](unsigned int b, size_t begin, size_t end)
+            {
+                size_t j = offsets[b];
+                for (size_t i = begin; i < end; i++)
+                {
+                    NodeKey nid(static_cast<key_value>(i));
+                    if (exists(nid))
+                    {
+                        points[j] = read(nid).get_pos();
+                        indices[i] = static_cast<int>(j);
+                        j++;
+                    }
+                }
+            });
+            
+            // Extract tetrahedra
+            m_thread_pool->parallel_blocks(no_tet_cells, [&](unsigned int b, size_t begin, size_t end)
+            {
+                size_t n = 0;
+                for (size_t i = begin; i < end; i++)
+                {
+                    if (exists(TetrahedronKey(static_cast<key_value>(i))))
+                    {
+                        n++;
+                    }
+                }
+                offsets[b+1] = n;
+            });
+            for (unsigned int b = 0; b < no_blocks; b++)
+            {
+                offsets[b+1] += offsets[b];
+            }
+            tets.resize(4*offsets[no_blocks]);
+            tet_labels.resize(offsets[no_blocks]);
+            m_thread_pool->parallel_blocks(no_tet_cells, [&](unsigned int b, size_t begin, size_t end)
+            {
+                size_t j = offsets[b];
+                for (size_t i = begin; i < end; i++)
+                {
+                    TetrahedronKey tid(static_cast<key_value>(i));
+                    if (exists(tid))
+                    {
+                        const SimplexSet<FaceKey>& fids = get_faces(tid);
+                        SimplexSet<NodeKey> nids = get_nodes(fids[0]);
+                        NodeKey apex = (get_nodes(fids[1]) - nids).front();
+                        for (unsigned int k = 0; k < 3; k++)
+                        {
+                            tets[4*j+k] = indices[nids[k]];
+                        }
+                        tets[4*j+3] = indices[apex];
+                        tet_labels[j] = get_label(tid);
+                        j++;
+                    }
+                }
+            });
+            advise(ACCESS_NORMAL);
+        }
+        
+    private:
+        /**
+         * Returns whether the tetrahedron tid and the simplices in its closure are correctly connected.
+         */
+        bool is_valid_connectivity(const TetrahedronKey& tid)
+        {
+            if(!exists(tid))
+            {
+                return false;
+            }
+            // Check faces:
+            const SimplexSet<FaceKey>& fids = get_faces(tid);
+            if(fids.size() != 4)
+            {
+                return false;
+            }
+            for (auto f : fids)
+            {
+                if(!exists(f))
+                {
+                    return false;
+                }
+                const SimplexSet<TetrahedronKey>& cotets = get_tets(f);
+                if(!((read(f).is_boundary() && cotets.size() == 1) || (!read(f).is_boundary() && cotets.size() == 2)) || !cotets.contains(tid))
+                {
+                    return false;
+                }
+                for (auto f2 : fids)
+                {
+                    if(f != f2 && !get_edge(f, f2).is_valid())
+                    {
+                        return false;
+                    }
+                }
+                
+                // Check the interface surface:
+                if(read(f).is_interface() != m_interface.contains(f) || (read(f).is_interface() && !(m_interface.nodes(f) == get_nodes(f))))
+                {
+                    return false;
+                }
+                
+                // Check edges:
+                const SimplexSet<EdgeKey>& eids = get_edges(f);
+                if(eids.size() != 3)
+                {
+                    return false;
+                }
+                for (auto e : eids)
+                {
+                    if(!exists(e) || !get_faces(e).contains(f))
+                    {
+                        return false;
+                    }
+                    for (auto e2 : eids)
+                    {
+                        if(e != e2 && !get_node(e, e2).is_valid())
+                        {
+                            return false;
+                        }
+                    }
+                    
+                    // Check nodes:
+                    const SimplexSet<NodeKey>& nids = get_nodes(e);
+                    if(nids.size() != 2)
+                    {
+                        return false;
+                    }
+                    for (auto n : nids)
+                    {
+                        if(!exists(n) || !get_edges(n).contains(e))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+            return get_edges(tid).size() == 6 && get_nodes(tid).size() == 4;
+        }
+        
+        /**
+         * Returns whether the interface and boundary flags of the edge eid agree with the flags of its faces.
+         */
+        bool is_valid_flags(const EdgeKey& eid)
+        {
+            int boundary = 0;
+            int interface = 0;
+            for (auto f : get_faces(eid))
+            {
+                if(read(f).is_boundary())
+                {
+                    boundary++;
+                }
+                if(read(f).is_interface())
+                {
+                    interface++;
+                }
+            }
+            return ((read(eid).is_interface() && interface >= 2) || (!read(eid).is_interface() && interface == 0)) && // Check that the interface is not corrupted
+                ((read(eid).is_boundary() && boundary == 2) || (!read(eid).is_boundary() && boundary == 0)); // Check that the boundary is not corrupted
+        }
+        
+        /**
+         * Checks the tetrahedra tids and the edges in their closure in parallel. Returns whether they are all valid.
+         */
+        bool is_valid(const std::vector<TetrahedronKey>& tids)
+        {
+            std::atomic<bool> valid(true);
+            m_thread_pool->parallel_for(0, tids.size(), [&](size_t i)
+            {
+                if(!is_valid_connectivity(tids[i]) || is_inverted(tids[i]))
+                {
+                    valid = false;
+                }
+            });
+            if(!valid)
+            {
+                return false;
+            }
+            
+            std::vector<EdgeKey> eids;
+            for (auto t : tids)
+            {
+                for (auto e : get_edges(t))
+                {
+                    eids.push_back(e);
+                }
+            }
+            std::sort(eids.begin(), eids.end());
+            eids.erase(std::unique(eids.begin(), eids.end()), eids.end());
+            m_thread_pool->parallel_for(0, eids.size(), [&](size_t i)
+            {
+                if(!is_valid_flags(eids[i]))
+                {
+                    valid = false;
+                }
+            });
+            return valid;
+        }
+        
+    public:
+        /**
+         * Checks the whole simplicial complex in parallel. Returns whether it is valid.
+         */
+        bool parallel_validity_check()
+        {
+            std::vector<TetrahedronKey> tids;
+            tids.reserve(get_no_tets());
+            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            {
+                tids.push_back(tit.key());
+            }
+            m_touched_nodes.clear();
+            m_touched_overflow = false;
+            return is_valid(tids);
+        }
+        
+        /**
+         * Checks the stars of the nodes touched by edits (splits, collapses, flips, label and position changes) since the last check.
+         * This is much cheaper than a full check when only a small part of the complex has changed, since the cost is in the
+         * size of the touched stars. Returns whether the stars are valid. The touched nodes are only recorded in debug builds
+         * or after track_touched_nodes(true), otherwise the whole complex is checked.
+         */
+        bool local_validity_check()
+        {
+            if(m_touched_overflow || !m_track_touched_nodes)
+            {
+                return parallel_validity_check();
+            }
+            
+            std::vector<TetrahedronKey> tids;
+            for (auto n : m_touched_nodes)
+            {
+                if(exists(n))
+                {
+                    for (auto t : get_tets(n))
+                    {
+                        tids.push_back(t);
+                    }
+                }
+            }
+            std::sort(tids.begin(), tids.end());
+            tids.erase(std::unique(tids.begin(), tids.end()), tids.end());
+            m_touched_nodes.clear();
+            return is_valid(tids);
+        }
+        
+        void validity_check()
+        {
+            std::cout << "Testing connectivity of simplicial complex: ";
+            for(auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            {
+                assert(is_valid_connectivity(tit.key()));
+            }
+            std::cout << "PASSED" << std::endl;
+            
+            std::cout << "Testing for inverted tetrahedra: ";
+            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            {
+                assert(!is_inverted(tit.key()));
+            }
+            std::cout << "PASSED" << std::endl;
+            
+            std::cout << "Testing for corrupted interface or boundary: ";
+            for (auto eit = edges_begin(); eit != edges_end(); eit++)
+            {
+                assert(is_valid_flags(eit.key()));
             }
             std::cout << "PASSED" << std::endl;
+            m_touched_nodes.clear();
+            m_touched_overflow = false;
         }
     };
     
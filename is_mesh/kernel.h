@@ -1,11 +1,15 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include <is_mesh/key.h>
 #include <is_mesh/kernel_iterator.h>
+#include <is_mesh/mapped_allocator.h>
 
 namespace is_mesh
 {
@@ -31,6 +35,8 @@ namespace is_mesh
             
             kernel_element() : value() { }
             
+            kernel_element(const kernel_element& ke) : value(ke.value), key(ke.key), state(ke.state) { }
+            
             kernel_element(kernel_element&& ke) : value() {
                 value = std::move(ke.value);
                 key = ke.key;
@@ -59,6 +65,12 @@ namespace is_mesh
      * undo operations. Each cell in the kernel uses an excess of 12 bytes, which is used to
      * support fast iterators through the kernel and the undo functionality.
      *
+     * The cells are stored in fixed size pages which are shared between copies of the kernel. Copying a kernel therefore only
+     * copies the page pointers, and a page is copied the first time it is accessed for writing while it is shared (copy-on-write).
+     * A copy is thereby a consistent snapshot which can be read on another thread while the original is being modified.
+     * If IS_MESH_MAPPED_KERNELS is defined, the pages are allocated in memory mapped files (see MappedAllocator), such that
+     * meshes larger than the main memory can be processed.
+     *
      * @param value_type The type of the elements that is to be stored in the kernel. The value_type
      *        must have the typedef type_traits.
      * @param key_type The type of the keys used in the kernel. Should be an integer type.
@@ -77,10 +89,43 @@ namespace is_mesh
     private:
         typedef typename value_type::type_traits                        type_traits;
         
-        std::vector<kernel_element> m_data;
+#ifdef IS_MESH_MAPPED_KERNELS
+        typedef          std::vector<kernel_element, MappedAllocator<kernel_element>> page;
+#else
+        typedef          std::vector<kernel_element>                    page;
+#endif
+        
+        static const unsigned int PAGE_BITS = 10;
+        static const unsigned int PAGE_SIZE = 1u << PAGE_BITS;
+        
+        std::vector<std::shared_ptr<page>> m_pages;
+        size_t m_no_cells = 0;
         std::vector<key_type> m_data_freelist;
         std::vector<key_type> m_data_marked_for_deletion;
     private:
+        /**
+         * Returns the page with index i for writing. If the page is shared with a copy of the kernel, it is copied first.
+         */
+        page& writable_page(size_t i)
+        {
+            std::shared_ptr<page>& p = m_pages[i];
+            if (p.use_count() > 1)
+            {
+                auto copy = std::make_shared<page>();
+                copy->reserve(PAGE_SIZE);
+                for (const kernel_element& element : *p)
+                {
+                    copy->push_back(element);
+                }
+                p = copy;
+            }
+            else {
+                // Synchronizes with the release of the page by a copy of the kernel on another thread.
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+            return *p;
+        }
+        
         /**
          * Converts an indirect reference to the direct memory reference currently allocated by the cell.
          *
@@ -92,8 +137,17 @@ namespace is_mesh
         {
 //          assume key_type is integer type
             assert(k >= 0 || !"looked up with negative element");
-            assert((int)k < m_data.size() || !"k out of range");
-            return m_data[k];
+            assert((size_t)k < m_no_cells || !"k out of range");
+            return writable_page(k >> PAGE_BITS)[k & (PAGE_SIZE - 1)];
+        }
+        
+        /**
+         * Converts an indirect reference to the direct memory reference for reading. Never copies a page.
+         */
+        const kernel_element& lookup(key_type k) const
+        {
+            assert((size_t)k < m_no_cells || !"k out of range");
+            return (*m_pages[k >> PAGE_BITS])[k & (PAGE_SIZE - 1)];
         }
         
         /**
@@ -105,17 +159,24 @@ namespace is_mesh
         {
             key_type key;
             if (m_data_freelist.size()==0){
-                key = m_data.size();
-                m_data.emplace_back();
-                kernel_element& element = m_data.back();
+                key = static_cast<key_value>(m_no_cells);
+                if ((m_no_cells >> PAGE_BITS) == m_pages.size())
+                {
+                    m_pages.push_back(std::make_shared<page>());
+                    m_pages.back()->reserve(PAGE_SIZE);
+                }
+                page& p = writable_page(m_no_cells >> PAGE_BITS);
+                p.emplace_back();
+                m_no_cells++;
+                kernel_element& element = p.back();
                 element.key = key;
                 element.state = kernel_element::EMPTY;
                 return element;
             } else {
                 key = m_data_freelist.back();
                 m_data_freelist.pop_back();
-                assert(m_data[key].key == key);
-                return m_data[key];
+                assert(lookup(key).key == key);
+                return lookup(key);
             }
         }
     public:
@@ -140,7 +201,12 @@ namespace is_mesh
         /**
          * The size of the kernel. That is the number of valid elements in the kernel.
          */
-        size_t size() const     { return m_data.size() - m_data_freelist.size(); }
+        size_t size() const     { return m_no_cells - m_data_freelist.size(); }
+        
+        /**
+         * The number of cells in the kernel, i.e. one more than the largest key in use. Arrays indexed by key should have this size.
+         */
+        size_t capacity() const { return m_no_cells; }
         
         /**
          * Returns a boolean value indicating if the size is zero.
@@ -172,7 +238,7 @@ namespace is_mesh
          */
         const_iterator end() const
         {
-            return iterator(this, key_type{(unsigned int)m_data.size()});
+            return iterator(this, key_type{static_cast<key_value>(m_no_cells)});
         }
         
         /**
@@ -180,10 +246,10 @@ namespace is_mesh
          */
         const_iterator begin() const
         {
-            unsigned int i = 0;
+            key_value i = 0;
             // find first valid element (if any)
-            for (;i<m_data.size();i++){
-                if (m_data[i].state == kernel_element::VALID){
+            for (;i<m_no_cells;i++){
+                if (lookup(key_type{i}).state == kernel_element::VALID){
                     break;
                 }
             }
@@ -225,7 +291,8 @@ namespace is_mesh
          */
         void clear()
         {
-            m_data.clear();
+            m_pages.clear();
+            m_no_cells = 0;
             m_data_freelist.clear();
             m_data_marked_for_deletion.clear();
         }
@@ -238,7 +305,7 @@ namespace is_mesh
         iterator find_iterator(key_type const & k)
         {
             //we don't just return iterator(this, k) as this is not defensive enough, we need to return valid values.
-            kernel_element& tmp = lookup(k);
+            const kernel_element& tmp = static_cast<const kernel_type*>(this)->lookup(k);
             if (tmp.state == kernel_element::VALID && tmp.key == k)
                 return iterator(this, k);
             else
@@ -261,13 +328,17 @@ namespace is_mesh
         }
         
         /**
-         * Returns a managed object.
+         * Returns a managed object for reading. Unlike find(), this never copies a shared page, so it is safe to call
+         * from several threads as long as the kernel is not modified.
          *
          * @param k     The handle to the object.
          */
-        value_type const & find_const(key_type const & k)
+        value_type const & find_const(key_type const & k) const
         {
-            return find(k);
+            const kernel_element& tmp = lookup(k);
+            assert(tmp.state == kernel_element::VALID);
+            assert(tmp.key == k);
+            return tmp.value;
         }
         
         /**
@@ -276,20 +347,54 @@ namespace is_mesh
          * @param k     The handle to the object.
          * @returns     True if the object is a valid element, false if it is marked for deletion or k refers to an empty cell.
          */
-        bool is_valid(key_type const & k)
+        bool is_valid(key_type const & k) const
         {
-            kernel_element& tmp = lookup(k);
+            const kernel_element& tmp = lookup(k);
             if (tmp.state == kernel_element::VALID) return true;
             return false;
         }
         
+        /**
+         * Copies the pages shared with copies of the kernel, such that later writes do not have to. Returns the number of
+         * copied pages.
+         */
+        size_t detach()
+        {
+            size_t no_copied = 0;
+            for (size_t i = 0; i < m_pages.size(); i++)
+            {
+                if(m_pages[i].use_count() > 1)
+                {
+                    writable_page(i);
+                    no_copied++;
+                }
+            }
+            return no_copied;
+        }
+        
+        /**
+         * Advises the operating system how the kernel is about to be accessed, e.g. ACCESS_SEQUENTIAL before a sweep through
+         * all the elements and ACCESS_RANDOM before local operations. Only has an effect if the pages are memory mapped.
+         */
+        void advise(AccessPattern access) const
+        {
+#ifdef IS_MESH_MAPPED_KERNELS
+            for (auto& p : m_pages)
+            {
+                MappedStorage::advise(p->data(), p->capacity()*sizeof(kernel_element), access);
+            }
+#else
+            (void)access;
+#endif
+        }
+        
         /**
          * Commits all the changes in the kernel, and permanently removes all the marked elements.
          */
         void commit_all()
         {
             for (auto key : m_data_marked_for_deletion){
-                auto & p = m_data[key];
+                auto & p = lookup(key);
 
                 //m_alloc.destroy(&p);  // needed?
                 p.state = kernel_element::EMPTY;
@@ -104,11 +104,11 @@ namespace is_mesh
          */
         iterator& operator++()
         {
-            kernel_element& cur = m_kernel->lookup(m_key);
+            const kernel_type* kernel = m_kernel;
             do {
                 // m_key++;
                 m_key.incr();
-            } while ((int)m_key < m_kernel->m_data.size() && m_kernel->lookup(m_key).state != element_type::VALID);
+            } while ((size_t)m_key < kernel->capacity() && kernel->lookup(m_key).state != element_type::VALID);
 //            m_key = cur.next;
             return *this;
         }
@@ -16,19 +16,32 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace is_mesh
 {
+    /**
+     * The integer type stored in a key. Keys are 32 bit, unless IS_MESH_64BIT_KEYS is defined. 64 bit keys allow more
+     * than 2^32 - 1 simplices of each kind (including the free cells in the kernels) at the cost of twice the memory per key.
+     * The largest value is reserved for invalid keys.
+     */
+#ifdef IS_MESH_64BIT_KEYS
+    typedef uint64_t key_value;
+#else
+    typedef uint32_t key_value;
+#endif
+    
     class Key
     {
     protected:
-        unsigned int key;
+        key_value key;
         
-        Key() : Key(static_cast<unsigned int>(-1))
+        Key() : Key(static_cast<key_value>(-1))
         {
             
         }
         
-        Key(unsigned int _key) : key(_key)
+        Key(key_value _key) : key(_key)
         {
             
         }
@@ -36,27 +49,27 @@ namespace is_mesh
     public:
         bool is_valid() const
         {
-            return key != static_cast<unsigned int>(-1);
+            return key != static_cast<key_value>(-1);
         }
         
         //conversion to int
-        operator unsigned int() const
+        operator key_value() const
         {
             return key;
         }
         
         friend inline bool operator==(Key    const & a, Key    const & b)   { return a.key == b.key; }
         friend inline bool operator==(Key          & a, Key          & b)   { return a.key == b.key; }
-        friend inline bool operator==(unsigned int const & k, Key    const & b)   { return   k   == b.key; }
-        friend inline bool operator==(Key    const & a, unsigned int const & k)   { return a.key ==   k;   }
+        friend inline bool operator==(key_value const & k, Key    const & b)   { return   k   == b.key; }
+        friend inline bool operator==(Key    const & a, key_value const & k)   { return a.key ==   k;   }
         friend inline bool operator!=(Key    const & a, Key    const & b)   { return a.key != b.key; }
         friend inline bool operator!=(Key          & a, Key          & b)   { return a.key != b.key; }
-        friend inline bool operator!=(unsigned int const & k, Key    const & b)   { return   k   != b.key; }
-        friend inline bool operator!=(Key    const & a, unsigned int const & k)   { return a.key !=   k;   }
+        friend inline bool operator!=(key_value const & k, Key    const & b)   { return   k   != b.key; }
+        friend inline bool operator!=(Key    const & a, key_value const & k)   { return a.key !=   k;   }
         friend inline bool operator< (Key    const & a, Key    const & b)   { return a.key <  b.key; }
         friend inline bool operator< (Key          & a, Key          & b)   { return a.key <  b.key; }
-        friend inline bool operator< (unsigned int const & k, Key    const & b)   { return   k   <  b.key; }
-        friend inline bool operator< (Key    const & a, unsigned int const & k)   { return a.key <    k;   }
+        friend inline bool operator< (key_value const & k, Key    const & b)   { return   k   <  b.key; }
+        friend inline bool operator< (Key    const & a, key_value const & k)   { return a.key <    k;   }
 
         void incr(){ key++; }
 
@@ -68,28 +81,28 @@ namespace is_mesh
     {
     public:
         NodeKey() : Key() {}
-        NodeKey(unsigned int k) : Key(k) {}
+        NodeKey(key_value k) : Key(k) {}
     };
     
     class EdgeKey : public Key
     {
     public:
         EdgeKey() : Key() {}
-        EdgeKey(unsigned int k) : Key(k) {}
+        EdgeKey(key_value k) : Key(k) {}
     };
     
     class FaceKey : public Key
     {
     public:
         FaceKey() : Key() {}
-        FaceKey(unsigned int k) : Key(k) {}
+        FaceKey(key_value k) : Key(k) {}
     };
     
     class TetrahedronKey : public Key
     {
     public:
         TetrahedronKey() : Key() {}
-        TetrahedronKey(unsigned int k) : Key(k) {}
+        TetrahedronKey(key_value k) : Key(k) {}
     };
     
 }
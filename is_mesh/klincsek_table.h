@@ -0,0 +1,203 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "util.h"
+
+namespace is_mesh
+{
+    /**
+     * The table of the dynamic programming method by Klincsek for triangulating the polygon around an edge, such that the
+     * minimum quality of the tetrahedra formed by the triangles and the two end points of the edge is maximized (see
+     * Shewchuk "Two Discrete Optimization Algorithms for the Topological Improvement of Tetrahedral Meshes").
+     *
+     * The positions are gathered into contiguous arrays, and the squared distances and cross products between pairs of
+     * polygon vertices are computed once, such that the quality of a tetrahedron in the dynamic program is a dot product
+     * and a sum. The qualities of the triangles over one polygon diagonal are computed in a flat loop, which the compiler
+     * can vectorize. The storage is kept between builds, so a table which is reused does not allocate.
+     */
+    class KlincsekTable
+    {
+        int m = 0;
+        std::vector<real> px, py, pz;
+
+        // Indexed by j*m + k: The squared distance between the polygon vertices j and k and the cross products (k-a)x(j-a)
+        // and (k-b)x(j-b) with the edge end points a and b.
+        std::vector<real> dist;
+        std::vector<real> cax, cay, caz, cbx, cby, cbz;
+
+        // The squared distances from the polygon vertices to a and b.
+        std::vector<real> dist_a, dist_b;
+
+        // The quality of the triangles i, k, j over the diagonal (i, j) for all k.
+        std::vector<real> row;
+
+        // The triangular tables of the best quality and the best split vertex for the diagonals (i, j), i < j.
+        std::vector<real> Q;
+        std::vector<int> K;
+
+        size_t index(int i, int j) const
+        {
+            return static_cast<size_t>(i*m - i*(i+1)/2 + j - i - 1);
+        }
+
+        void gather(const vec3& a, const vec3& b)
+        {
+            dist.resize(m*m);
+            for (auto v : {&cax, &cay, &caz, &cbx, &cby, &cbz})
+            {
+                v->resize(m*m);
+            }
+            dist_a.resize(m);
+            dist_b.resize(m);
+            for (int j = 0; j < m; j++)
+            {
+                dist_a[j] = Util::sqr_length(vec3(px[j], py[j], pz[j]) - a);
+                dist_b[j] = Util::sqr_length(vec3(px[j], py[j], pz[j]) - b);
+                for (int k = 0; k < m; k++)
+                {
+                    int jk = j*m + k;
+                    dist[jk] = (px[j]-px[k])*(px[j]-px[k]) + (py[j]-py[k])*(py[j]-py[k]) + (pz[j]-pz[k])*(pz[j]-pz[k]);
+                    real ux = px[k] - a[0], uy = py[k] - a[1], uz = pz[k] - a[2];
+                    real vx = px[j] - a[0], vy = py[j] - a[1], vz = pz[j] - a[2];
+                    cax[jk] = uy*vz - uz*vy;
+                    cay[jk] = uz*vx - ux*vz;
+                    caz[jk] = ux*vy - uy*vx;
+                    ux = px[k] - b[0]; uy = py[k] - b[1]; uz = pz[k] - b[2];
+                    vx = px[j] - b[0]; vy = py[j] - b[1]; vz = pz[j] - b[2];
+                    cbx[jk] = uy*vz - uz*vy;
+                    cby[jk] = uz*vx - ux*vz;
+                    cbz[jk] = ux*vy - uy*vx;
+                }
+            }
+        }
+
+        /**
+         * Computes row[k], for i < k < j, as the minimum quality of the tetrahedra (i, k, a, j) and (k, i, b, j), which is
+         * Util::quality() expressed by the precomputed terms.
+         */
+        void compute_row(int i, int j, const vec3& a, const vec3& b)
+        {
+            const real rx = px[i] - a[0], ry = py[i] - a[1], rz = pz[i] - a[2];
+            const real sx = px[i] - b[0], sy = py[i] - b[1], sz = pz[i] - b[2];
+            const real fixed_a = dist[j*m + i] + dist_a[i] + dist_a[j];
+            const real fixed_b = dist[j*m + i] + dist_b[i] + dist_b[j];
+            const real* d_i = &dist[i*m];
+            const real* d_j = &dist[j*m];
+            for (int k = i+1; k < j; k++)
+            {
+                int jk = j*m + k;
+                real v_a = -(rx*cax[jk] + ry*cay[jk] + rz*caz[jk])/6.;
+                real v_b = (sx*cbx[jk] + sy*cby[jk] + sz*cbz[jk])/6.;
+                real ms_a = (fixed_a + d_i[k] + d_j[k] + dist_a[k])/6.;
+                real ms_b = (fixed_b + d_i[k] + d_j[k] + dist_b[k])/6.;
+                real q_a = 8.48528*v_a/(ms_a*std::sqrt(ms_a));
+                real q_b = 8.48528*v_b/(ms_b*std::sqrt(ms_b));
+                row[k] = Util::min(q_a, q_b);
+            }
+        }
+
+    public:
+        void clear()
+        {
+            m = 0;
+            px.clear();
+            py.clear();
+            pz.clear();
+        }
+
+        /**
+         * Appends a vertex to the polygon.
+         */
+        void push_back(const vec3& p)
+        {
+            px.push_back(p[0]);
+            py.push_back(p[1]);
+            pz.push_back(p[2]);
+            m++;
+        }
+
+        int size() const
+        {
+            return m;
+        }
+
+        /**
+         * Builds the table for the polygon around the edge with the end points a and b and returns the minimum quality of
+         * the best triangulation.
+         */
+        real build(const vec3& a, const vec3& b)
+        {
+            gather(a, b);
+            row.resize(m);
+            Q.assign(index(m-2, m-1) + 1, 0.);
+            K.assign(Q.size(), 0);
+
+            for (int i = 0; i < m-1; i++)
+            {
+                Q[index(i, i+1)] = INFINITY;
+            }
+
+            for (int i = m-3; i >= 0; i--)
+            {
+                for (int j = i+2; j < m; j++)
+                {
+                    compute_row(i, j, a, b);
+                    size_t ij = index(i, j);
+                    for (int k = i+1; k < j; k++)
+                    {
+                        real q = row[k];
+                        if (k < j-1)
+                        {
+                            q = Util::min(q, Q[index(k, j)]);
+                        }
+                        if (k > i+1)
+                        {
+                            q = Util::min(q, Q[index(i, k)]);
+                        }
+
+                        if (k == i+1 || q > Q[ij])
+                        {
+                            Q[ij] = q;
+                            K[ij] = k;
+                        }
+                    }
+                }
+            }
+            return Q[index(0, m-1)];
+        }
+
+        /**
+         * Returns the minimum quality of the best triangulation of the part of the polygon from vertex i to vertex j.
+         */
+        real quality(int i, int j) const
+        {
+            return Q[index(i, j)];
+        }
+        
+        /**
+         * Returns the vertex which the diagonal (i, j) is split at in the best triangulation.
+         */
+        int operator()(int i, int j) const
+        {
+            return K[index(i, j)];
+        }
+    };
+}
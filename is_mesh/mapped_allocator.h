@@ -0,0 +1,157 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace is_mesh
+{
+    /**
+     * Hints about how memory is about to be accessed.
+     */
+    enum AccessPattern {ACCESS_NORMAL, ACCESS_SEQUENTIAL, ACCESS_RANDOM};
+
+    /**
+     * Settings shared by all mapped allocations.
+     */
+    class MappedStorage
+    {
+    public:
+        /**
+         * The directory in which the backing files are created. The files are unlinked right after creation, so they
+         * disappear when the memory is released or the process ends. If empty, anonymous mappings (backed by swap) are used.
+         */
+        static std::string& directory()
+        {
+            static std::string dir = "/tmp";
+            return dir;
+        }
+
+        /**
+         * Advises the operating system how the memory [p, p + bytes) is about to be accessed.
+         */
+        static void advise(void* p, size_t bytes, AccessPattern access)
+        {
+#ifndef _WIN32
+            int advice = MADV_NORMAL;
+            if(access == ACCESS_SEQUENTIAL)
+            {
+                advice = MADV_SEQUENTIAL;
+            }
+            else if(access == ACCESS_RANDOM)
+            {
+                advice = MADV_RANDOM;
+            }
+            madvise(p, bytes, advice);
+#endif
+        }
+    };
+
+    /**
+     * An allocator which places each allocation in its own memory mapped file, such that the operating system can page
+     * it out to disk instead of swap when the memory is exhausted. On platforms without mmap it falls back to the heap.
+     */
+    template<typename T>
+    class MappedAllocator
+    {
+    public:
+        typedef T value_type;
+
+        MappedAllocator()
+        {
+
+        }
+
+        template<typename U>
+        MappedAllocator(const MappedAllocator<U>&)
+        {
+
+        }
+
+        T* allocate(size_t n)
+        {
+#ifndef _WIN32
+            size_t bytes = n*sizeof(T);
+            int fd = -1;
+            int flags = MAP_ANONYMOUS | MAP_PRIVATE;
+            if(!MappedStorage::directory().empty())
+            {
+                std::string path = MappedStorage::directory() + "/is_mesh_XXXXXX";
+                std::vector<char> name(path.begin(), path.end());
+                name.push_back('\0');
+                fd = mkstemp(name.data());
+                if(fd >= 0)
+                {
+                    unlink(name.data());
+                    if(ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+                    {
+                        flags = MAP_SHARED;
+                    }
+                    else {
+                        close(fd);
+                        fd = -1;
+                    }
+                }
+            }
+            void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, fd, 0);
+            if(fd >= 0)
+            {
+                close(fd);
+            }
+            if(p == MAP_FAILED)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(p);
+#else
+            return std::allocator<T>().allocate(n);
+#endif
+        }
+
+        void deallocate(T* p, size_t n)
+        {
+#ifndef _WIN32
+            munmap(p, n*sizeof(T));
+#else
+            std::allocator<T>().deallocate(p, n);
+#endif
+        }
+
+        template<typename U>
+        bool operator==(const MappedAllocator<U>&) const
+        {
+            return true;
+        }
+
+        template<typename U>
+        bool operator!=(const MappedAllocator<U>&) const
+        {
+            return false;
+        }
+    };
+}
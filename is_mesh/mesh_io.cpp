@@ -15,7 +15,10 @@
 //  See licence.txt for a copy of the GNU General Public License.
 
 #include "mesh_io.h"
+#include <algorithm>
+#include <cstdint>
 #include <fstream>
+#include <numeric>
 
 namespace is_mesh {
     
@@ -245,7 +248,8 @@ namespace is_mesh {
             vec3 height(x,y,z);
             return new Square(center, width, height);
         }
-        return new Geometry();
+        // An empty multiple geometry contains everything.
+        return new MultipleGeometry();
     }
     
     void import_geometry(const std::string& filename, vec3& origin, vec3& size, real& discretization, std::vector<unsigned int>& labels, std::vector<Geometry*>& geometries)
@@ -323,7 +327,7 @@ namespace is_mesh {
             {
                 obj_file << "f ";
             }
-            obj_file << faces[i];
+            obj_file << faces[i] + 1; // Indices in .obj files start at 1.
             if (i%3 == 2)
             {
                 obj_file << std::endl;
@@ -335,4 +339,80 @@ namespace is_mesh {
         
         obj_file.close();
     }
+    
+    /**
+     * Returns the Morton code of p in the box [p_min, p_min + size] using 10 bits per axis.
+     */
+    std::uint32_t morton_code(const vec3& p, const vec3& p_min, const vec3& size)
+    {
+        std::uint32_t code = 0;
+        std::uint32_t c[3];
+        for (int i = 0; i < 3; i++) {
+            real x = size[i] > 0. ? (p[i] - p_min[i])/size[i] : 0.;
+            c[i] = static_cast<std::uint32_t>(Util::min(Util::max(x, 0.), 1.)*1023.);
+        }
+        for (int b = 9; b >= 0; b--) {
+            for (int i = 0; i < 3; i++) {
+                code = (code << 1) | ((c[i] >> b) & 1);
+            }
+        }
+        return code;
+    }
+    
+    void sort_spatially(std::vector<vec3>& points, std::vector<int>& tets, std::vector<int>& tet_labels)
+    {
+        vec3 p_min(INFINITY), p_max(-INFINITY);
+        for (vec3 p : points) {
+            for (int i = 0; i < 3; i++) {
+                p_min[i] = Util::min(p[i], p_min[i]);
+                p_max[i] = Util::max(p[i], p_max[i]);
+            }
+        }
+        vec3 size = p_max - p_min;
+        
+        // Sort the points
+        std::vector<std::uint32_t> codes(points.size());
+        for (unsigned int i = 0; i < points.size(); i++) {
+            codes[i] = morton_code(points[i], p_min, size);
+        }
+        std::vector<int> order(points.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return codes[a] < codes[b]; });
+        
+        std::vector<int> new_index(points.size());
+        std::vector<vec3> sorted_points(points.size());
+        for (unsigned int i = 0; i < order.size(); i++) {
+            new_index[order[i]] = i;
+            sorted_points[i] = points[order[i]];
+        }
+        points.swap(sorted_points);
+        for (int& t : tets) {
+            t = new_index[t];
+        }
+        
+        // Sort the tetrahedra by the Morton code of their barycenter
+        const unsigned int no_tets = static_cast<unsigned int>(tets.size()/4);
+        codes.resize(no_tets);
+        for (unsigned int i = 0; i < no_tets; i++) {
+            vec3 c = Util::barycenter(points[tets[4*i]], points[tets[4*i+1]], points[tets[4*i+2]], points[tets[4*i+3]]);
+            codes[i] = morton_code(c, p_min, size);
+        }
+        order.resize(no_tets);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return codes[a] < codes[b]; });
+        
+        std::vector<int> sorted_tets(tets.size());
+        std::vector<int> sorted_labels(tet_labels.size());
+        for (unsigned int i = 0; i < no_tets; i++) {
+            for (int j = 0; j < 4; j++) {
+                sorted_tets[4*i+j] = tets[4*order[i]+j];
+            }
+            if(order[i] < static_cast<int>(tet_labels.size()))
+            {
+                sorted_labels[i] = tet_labels[order[i]];
+            }
+        }
+        tets.swap(sorted_tets);
+        tet_labels.swap(sorted_labels);
+    }
 }
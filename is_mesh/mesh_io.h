@@ -55,4 +55,11 @@ namespace is_mesh {
      * Exports the surface mesh to an .obj file.
      */
     void export_surface_mesh(const std::string& filename, std::vector<vec3>& points, std::vector<int>& faces);
+    
+    /**
+     * Reorders the points and tetrahedra along a space filling curve (Morton order), such that simplices which are close
+     * in space get nearby keys in the mesh. This improves the memory locality of local operations, in particular when the
+     * kernels are memory mapped. The tetrahedra refer to the reordered points and the labels follow their tetrahedra.
+     */
+    void sort_spatially(std::vector<vec3>& points, std::vector<int>& tets, std::vector<int>& tet_labels);
 }
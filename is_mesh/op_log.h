@@ -0,0 +1,190 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "key.h"
+
+namespace is_mesh
+{
+    /**
+     * A compact binary log of the operations performed on a mesh. Each entry is an operation code followed by its arguments
+     * (keys as key_value integers and positions as three doubles). Replaying the log on a copy of the initial mesh reproduces
+     * the exact same sequence of keys and positions, see ISMesh::record() and ISMesh::replay().
+     */
+    class OpLog
+    {
+    public:
+        enum Op : unsigned char {SPLIT, COLLAPSE, FLIP_23, FLIP_32, FLIP, SET_POS, SET_LABEL, SCALE, GARBAGE_COLLECT};
+
+    private:
+        std::vector<char> data;
+
+        template<typename T>
+        void write_raw(const T& v)
+        {
+            const char* bytes = reinterpret_cast<const char*>(&v);
+            data.insert(data.end(), bytes, bytes + sizeof(T));
+        }
+
+        void write_value(const Key& k)
+        {
+            write_raw(static_cast<key_value>(k));
+        }
+
+        void write_value(const vec3& v)
+        {
+            write_raw(v[0]);
+            write_raw(v[1]);
+            write_raw(v[2]);
+        }
+
+        void write_value(real v)
+        {
+            write_raw(v);
+        }
+
+        void write_value(int v)
+        {
+            write_raw(v);
+        }
+
+        void write_values()
+        {
+
+        }
+
+        template<typename T, typename... Ts>
+        void write_values(const T& v, const Ts&... vs)
+        {
+            write_value(v);
+            write_values(vs...);
+        }
+
+    public:
+        /**
+         * Reads the entries of a log in order.
+         */
+        class Reader
+        {
+            const OpLog& log;
+            size_t pos = 0;
+
+            template<typename T>
+            T read_raw()
+            {
+                assert(pos + sizeof(T) <= log.data.size());
+                T v;
+                std::memcpy(&v, &log.data[pos], sizeof(T));
+                pos += sizeof(T);
+                return v;
+            }
+
+        public:
+            Reader(const OpLog& log_) : log(log_)
+            {
+
+            }
+
+            bool done() const
+            {
+                return pos >= log.data.size();
+            }
+
+            Op read_op()
+            {
+                return static_cast<Op>(read_raw<unsigned char>());
+            }
+
+            template<typename key_type>
+            key_type read_key()
+            {
+                return key_type(read_raw<key_value>());
+            }
+
+            vec3 read_vec3()
+            {
+                vec3 v;
+                v[0] = read_raw<real>();
+                v[1] = read_raw<real>();
+                v[2] = read_raw<real>();
+                return v;
+            }
+
+            real read_real()
+            {
+                return read_raw<real>();
+            }
+
+            int read_int()
+            {
+                return read_raw<int>();
+            }
+        };
+
+        /**
+         * Appends the operation op with the arguments args.
+         */
+        template<typename... Ts>
+        void record(Op op, const Ts&... args)
+        {
+            write_raw(static_cast<unsigned char>(op));
+            write_values(args...);
+        }
+
+        void clear()
+        {
+            data.clear();
+        }
+
+        /**
+         * Returns the size of the log in bytes.
+         */
+        size_t size() const
+        {
+            return data.size();
+        }
+
+        bool save(const std::string& filename) const
+        {
+            std::ofstream file(filename, std::ios::binary);
+            if(!file)
+            {
+                return false;
+            }
+            file.write(data.data(), data.size());
+            return static_cast<bool>(file);
+        }
+
+        bool load(const std::string& filename)
+        {
+            std::ifstream file(filename, std::ios::binary);
+            if(!file)
+            {
+                return false;
+            }
+            data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            return true;
+        }
+    };
+}
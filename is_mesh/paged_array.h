@@ -0,0 +1,229 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace is_mesh
+{
+    /**
+     * An array stored in fixed size pages which are shared between copies of the array, like the pages of the kernel.
+     * Copying the array only copies the page pointers, and a page is copied the first time it is written while it is shared
+     * (copy-on-write). Reading with operator[] never copies, writing goes through write().
+     */
+    template<typename T>
+    class PagedArray
+    {
+    public:
+        typedef T value_type;
+
+    private:
+        typedef std::vector<T> page;
+
+        static const unsigned int PAGE_BITS = 10;
+        static const unsigned int PAGE_SIZE = 1u << PAGE_BITS;
+
+        std::vector<std::shared_ptr<page>> m_pages;
+        size_t m_size = 0;
+
+        /**
+         * Returns the page with index i for writing. If the page is shared with a copy of the array, it is copied first.
+         */
+        page& writable_page(size_t i)
+        {
+            std::shared_ptr<page>& p = m_pages[i];
+            if (p.use_count() > 1)
+            {
+                p = std::make_shared<page>(*p);
+            }
+            else {
+                // Synchronizes with the release of the page by a copy of the array on another thread.
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+            return *p;
+        }
+
+    public:
+        typedef typename page::reference reference;
+        typedef typename page::const_reference const_reference;
+
+        class const_iterator
+        {
+            const PagedArray* array;
+            size_t k;
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const T* pointer;
+            typedef typename PagedArray::const_reference reference;
+
+            const_iterator(const PagedArray* array_, size_t k_) : array(array_), k(k_) {}
+
+            reference operator*() const
+            {
+                return (*array)[k];
+            }
+
+            const_iterator& operator++()
+            {
+                k++;
+                return *this;
+            }
+
+            const_iterator operator++(int)
+            {
+                const_iterator it(*this);
+                k++;
+                return it;
+            }
+
+            bool operator==(const const_iterator& other) const
+            {
+                return k == other.k;
+            }
+
+            bool operator!=(const const_iterator& other) const
+            {
+                return k != other.k;
+            }
+        };
+
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        const_reference operator[](size_t k) const
+        {
+            assert(k < m_size);
+            return (*m_pages[k >> PAGE_BITS])[k & (PAGE_SIZE - 1)];
+        }
+
+        /**
+         * Returns the value at k for writing. Copies the page of k if it is shared with a copy of the array.
+         */
+        reference write(size_t k)
+        {
+            assert(k < m_size);
+            return writable_page(k >> PAGE_BITS)[k & (PAGE_SIZE - 1)];
+        }
+
+        /**
+         * Returns whether the page of k is shared with a copy of the array, i.e. whether write(k) would copy it.
+         */
+        bool is_shared(size_t k) const
+        {
+            assert(k < m_size);
+            return m_pages[k >> PAGE_BITS].use_count() > 1;
+        }
+
+        const_reference back() const
+        {
+            return (*this)[m_size - 1];
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(this, m_size);
+        }
+
+        /**
+         * Resizes the array to the given size. New values are set to value.
+         */
+        void resize(size_t size, const T& value = T())
+        {
+            while (m_size < size)
+            {
+                size_t i = m_size >> PAGE_BITS;
+                size_t page_end = std::min((i + 1) << PAGE_BITS, size);
+                if (i == m_pages.size())
+                {
+                    m_pages.push_back(std::make_shared<page>(PAGE_SIZE, value));
+                }
+                else {
+                    page& p = writable_page(i);
+                    std::fill(p.begin() + (m_size & (PAGE_SIZE - 1)), p.begin() + (page_end - (i << PAGE_BITS)), value);
+                }
+                m_size = page_end;
+            }
+            if (size < m_size)
+            {
+                m_pages.resize((size + PAGE_SIZE - 1) >> PAGE_BITS);
+                m_size = size;
+            }
+        }
+
+        void push_back(const T& value)
+        {
+            resize(m_size + 1, value);
+        }
+
+        void pop_back()
+        {
+            assert(m_size > 0);
+            resize(m_size - 1);
+        }
+
+        void clear()
+        {
+            m_pages.clear();
+            m_size = 0;
+        }
+
+        /**
+         * Copies the pages shared with copies of the array, such that later writes do not have to. Returns the number of
+         * copied pages.
+         */
+        size_t detach()
+        {
+            size_t no_copied = 0;
+            for (size_t i = 0; i < m_pages.size(); i++)
+            {
+                if(m_pages[i].use_count() > 1)
+                {
+                    writable_page(i);
+                    no_copied++;
+                }
+            }
+            return no_copied;
+        }
+    };
+
+    template<typename T>
+    const unsigned int PagedArray<T>::PAGE_BITS;
+
+    template<typename T>
+    const unsigned int PagedArray<T>::PAGE_SIZE;
+}
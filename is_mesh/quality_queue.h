@@ -0,0 +1,190 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "util.h"
+
+namespace is_mesh
+{
+    /**
+     * An indexed binary min-heap of simplices keyed by their quality. Each simplex is in the heap at most once, so pushing
+     * a simplex which is already in the heap updates its quality. Ties are broken by key such that the order is deterministic.
+     */
+    template<typename key_type>
+    class QualityQueue
+    {
+        struct entry
+        {
+            key_type key;
+            real quality;
+        };
+
+        std::vector<entry> m_heap;
+        std::vector<int> m_index;
+
+        bool less(unsigned int i, unsigned int j) const
+        {
+            return m_heap[i].quality < m_heap[j].quality ||
+                (m_heap[i].quality == m_heap[j].quality && m_heap[i].key < m_heap[j].key);
+        }
+
+        void swap(unsigned int i, unsigned int j)
+        {
+            std::swap(m_heap[i], m_heap[j]);
+            m_index[m_heap[i].key] = static_cast<int>(i);
+            m_index[m_heap[j].key] = static_cast<int>(j);
+        }
+
+        void sift_up(unsigned int i)
+        {
+            while(i > 0 && less(i, (i-1)/2))
+            {
+                swap(i, (i-1)/2);
+                i = (i-1)/2;
+            }
+        }
+
+        void sift_down(unsigned int i)
+        {
+            while(true)
+            {
+                unsigned int m = i;
+                unsigned int l = 2*i + 1;
+                unsigned int r = 2*i + 2;
+                if(l < m_heap.size() && less(l, m))
+                {
+                    m = l;
+                }
+                if(r < m_heap.size() && less(r, m))
+                {
+                    m = r;
+                }
+                if(m == i)
+                {
+                    return;
+                }
+                swap(i, m);
+                i = m;
+            }
+        }
+
+    public:
+        bool empty() const
+        {
+            return m_heap.empty();
+        }
+
+        size_t size() const
+        {
+            return m_heap.size();
+        }
+
+        bool contains(const key_type& k) const
+        {
+            return static_cast<size_t>(k) < m_index.size() && m_index[k] >= 0;
+        }
+
+        /**
+         * Inserts the simplex k with the given quality, or updates its quality if it is already in the heap.
+         */
+        void push(const key_type& k, real quality)
+        {
+            if(contains(k))
+            {
+                unsigned int i = static_cast<unsigned int>(m_index[k]);
+                real old_quality = m_heap[i].quality;
+                m_heap[i].quality = quality;
+                if(quality < old_quality)
+                {
+                    sift_up(i);
+                }
+                else {
+                    sift_down(i);
+                }
+                return;
+            }
+            if(static_cast<size_t>(k) >= m_index.size())
+            {
+                m_index.resize(std::max(static_cast<size_t>(k) + 1, 2*m_index.size()), -1);
+            }
+            m_index[k] = static_cast<int>(m_heap.size());
+            m_heap.push_back({k, quality});
+            sift_up(static_cast<unsigned int>(m_heap.size() - 1));
+        }
+
+        /**
+         * Returns the simplex with the lowest quality.
+         */
+        const key_type& top() const
+        {
+            assert(!empty());
+            return m_heap.front().key;
+        }
+
+        /**
+         * Returns the lowest quality in the heap.
+         */
+        real top_quality() const
+        {
+            assert(!empty());
+            return m_heap.front().quality;
+        }
+
+        /**
+         * Removes and returns the simplex with the lowest quality.
+         */
+        key_type pop()
+        {
+            key_type k = top();
+            erase(k);
+            return k;
+        }
+
+        /**
+         * Removes the simplex k from the heap if it is in the heap.
+         */
+        void erase(const key_type& k)
+        {
+            if(!contains(k))
+            {
+                return;
+            }
+            unsigned int i = static_cast<unsigned int>(m_index[k]);
+            unsigned int last = static_cast<unsigned int>(m_heap.size() - 1);
+            if(i != last)
+            {
+                swap(i, last);
+            }
+            m_heap.pop_back();
+            m_index[k] = -1;
+            if(i < m_heap.size())
+            {
+                sift_up(i);
+                sift_down(i);
+            }
+        }
+
+        void clear()
+        {
+            m_heap.clear();
+            m_index.clear();
+        }
+    };
+}
@@ -0,0 +1,268 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "simplex_set.h"
+#include "thread_pool.h"
+
+namespace is_mesh
+{
+    /**
+     * Partitions candidate simplices into batches such that no two candidates in the same batch conflict. Each candidate
+     * comes with the region of the mesh it edits (for example the tetrahedra in the star of a node) and two candidates
+     * conflict when their regions overlap. The candidates of one batch can therefore be processed concurrently.
+     */
+    class Scheduler
+    {
+    public:
+        enum Method {GREEDY_COLORING, LUBY};
+
+    private:
+        ThreadPool& pool;
+
+        static std::uint64_t priority(std::uint64_t i)
+        {
+            // splitmix64, gives a fixed pseudo-random priority for each candidate.
+            i += 0x9E3779B97F4A7C15ull;
+            i = (i ^ (i >> 30)) * 0xBF58476D1CE4E5B9ull;
+            i = (i ^ (i >> 27)) * 0x94D049BB133111EBull;
+            return i ^ (i >> 31);
+        }
+
+        /**
+         * Maps the keys of the regions to dense indices, such that the region of candidate i is given by the indices
+         * local[offsets[i]], ..., local[offsets[i+1]-1]. Returns the number of distinct keys. The memory used is in the total
+         * size of the regions and not in the largest key.
+         */
+        template<typename region_key_type>
+        static size_t dense_regions(const std::vector<SimplexSet<region_key_type>>& regions, std::vector<size_t>& offsets, std::vector<unsigned int>& local)
+        {
+            offsets.assign(regions.size() + 1, 0);
+            std::vector<std::pair<region_key_type, size_t>> keys;
+            for (size_t i = 0; i < regions.size(); i++)
+            {
+                for (auto k : regions[i])
+                {
+                    keys.push_back({k, keys.size()});
+                }
+                offsets[i+1] = keys.size();
+            }
+            std::sort(keys.begin(), keys.end());
+
+            local.resize(keys.size());
+            size_t N = 0;
+            for (size_t u = 0; u < keys.size(); u++)
+            {
+                if(u > 0 && keys[u].first != keys[u-1].first)
+                {
+                    N++;
+                }
+                local[keys[u].second] = static_cast<unsigned int>(N);
+            }
+            return keys.empty() ? 0 : N + 1;
+        }
+
+        /**
+         * Returns the offsets into a list of the candidates using each of the N local keys, see dense_regions().
+         */
+        static std::vector<size_t> key_offsets(size_t N, const std::vector<unsigned int>& local)
+        {
+            std::vector<size_t> offsets(N+1, 0);
+            for (auto k : local)
+            {
+                offsets[k+1]++;
+            }
+            for (size_t k = 0; k < N; k++)
+            {
+                offsets[k+1] += offsets[k];
+            }
+            return offsets;
+        }
+
+        /**
+         * First-fit greedy coloring in the order of the candidates. Deterministic.
+         */
+        template<typename key_type, typename region_key_type>
+        std::vector<std::vector<key_type>> greedy_coloring(const std::vector<key_type>& candidates, const std::vector<SimplexSet<region_key_type>>& regions)
+        {
+            std::vector<size_t> offsets;
+            std::vector<unsigned int> local;
+            const size_t N = dense_regions(regions, offsets, local);
+
+            // The colors of the candidates which have been colored, listed for each key in their regions.
+            std::vector<size_t> color_offsets = key_offsets(N, local);
+            std::vector<size_t> fill(color_offsets.begin(), color_offsets.end()-1);
+            std::vector<unsigned int> colors(local.size());
+
+            std::vector<std::vector<key_type>> batches;
+            std::vector<unsigned int> taken;
+            for (unsigned int i = 0; i < candidates.size(); i++)
+            {
+                taken.clear();
+                for (size_t u = offsets[i]; u < offsets[i+1]; u++)
+                {
+                    unsigned int k = local[u];
+                    taken.insert(taken.end(), colors.begin() + color_offsets[k], colors.begin() + fill[k]);
+                }
+                std::sort(taken.begin(), taken.end());
+
+                unsigned int b = 0;
+                for (auto c : taken)
+                {
+                    if(c > b)
+                    {
+                        break;
+                    }
+                    if(c == b)
+                    {
+                        b++;
+                    }
+                }
+                if(b == batches.size())
+                {
+                    batches.push_back({});
+                }
+                batches[b].push_back(candidates[i]);
+                for (size_t u = offsets[i]; u < offsets[i+1]; u++)
+                {
+                    colors[fill[local[u]]++] = b;
+                }
+            }
+            return batches;
+        }
+
+        /**
+         * Luby's algorithm: in each round every remaining candidate with a higher priority than all its remaining
+         * neighbours in the conflict graph is selected. The selection of a round is done in parallel.
+         */
+        template<typename key_type, typename region_key_type>
+        std::vector<std::vector<key_type>> luby(const std::vector<key_type>& candidates, const std::vector<SimplexSet<region_key_type>>& regions)
+        {
+            std::vector<size_t> region_offsets;
+            std::vector<unsigned int> local;
+            const size_t N = dense_regions(regions, region_offsets, local);
+            const size_t M = candidates.size();
+
+            // Map each region key to the candidates whose region contain it.
+            std::vector<size_t> offsets = key_offsets(N, local);
+            std::vector<unsigned int> users(offsets[N]);
+            std::vector<size_t> fill(offsets.begin(), offsets.end()-1);
+            for (unsigned int i = 0; i < M; i++)
+            {
+                for (size_t u = region_offsets[i]; u < region_offsets[i+1]; u++)
+                {
+                    users[fill[local[u]]++] = i;
+                }
+            }
+
+            std::vector<std::uint64_t> prio(M);
+            for (unsigned int i = 0; i < M; i++)
+            {
+                prio[i] = priority(i);
+            }
+
+            std::vector<char> remaining(M, 1), selected(M, 0);
+            std::vector<unsigned int> todo(M);
+            for (unsigned int i = 0; i < M; i++)
+            {
+                todo[i] = i;
+            }
+
+            std::vector<std::vector<key_type>> batches;
+            while(!todo.empty())
+            {
+                pool.parallel_for(0, todo.size(), [&](size_t j)
+                {
+                    unsigned int i = todo[j];
+                    for (size_t v = region_offsets[i]; v < region_offsets[i+1]; v++)
+                    {
+                        unsigned int k = local[v];
+                        for (size_t u = offsets[k]; u < offsets[k+1]; u++)
+                        {
+                            unsigned int n = users[u];
+                            if(n != i && remaining[n] && (prio[n] > prio[i] || (prio[n] == prio[i] && n < i)))
+                            {
+                                return;
+                            }
+                        }
+                    }
+                    selected[i] = 1;
+                });
+
+                std::vector<key_type> batch;
+                std::vector<unsigned int> rest;
+                for (unsigned int i : todo)
+                {
+                    if(selected[i])
+                    {
+                        batch.push_back(candidates[i]);
+                        remaining[i] = 0;
+                    }
+                    else {
+                        rest.push_back(i);
+                    }
+                }
+                batches.push_back(batch);
+                todo.swap(rest);
+            }
+            return batches;
+        }
+
+    public:
+
+        Scheduler(ThreadPool& pool_) : pool(pool_)
+        {
+
+        }
+
+        /**
+         * Returns the candidates partitioned into batches of non-conflicting candidates. The region edited by candidates[i]
+         * must be given in regions[i].
+         */
+        template<typename key_type, typename region_key_type>
+        std::vector<std::vector<key_type>> independent_sets(const std::vector<key_type>& candidates, const std::vector<SimplexSet<region_key_type>>& regions, Method method = GREEDY_COLORING)
+        {
+            assert(candidates.size() == regions.size());
+            if(method == LUBY)
+            {
+                return luby(candidates, regions);
+            }
+            return greedy_coloring(candidates, regions);
+        }
+
+        /**
+         * Applies f to every candidate in the batches. The batches are processed one at a time and the candidates of a batch in parallel.
+         * Since the kernels are not thread safe, f must not insert or remove simplices.
+         */
+        template<typename key_type, typename function>
+        void apply(const std::vector<std::vector<key_type>>& batches, const function& f)
+        {
+            for (auto& batch : batches)
+            {
+                pool.parallel_for(0, batch.size(), [&](size_t i)
+                {
+                    f(batch[i]);
+                }, 16);
+            }
+        }
+    };
+}
@@ -29,80 +29,63 @@ namespace is_mesh
     template<typename boundary_key_type, typename co_boundary_key_type>
     class Simplex
     {
-        SimplexSet<boundary_key_type>* m_boundary = nullptr;
-        SimplexSet<co_boundary_key_type>* m_co_boundary = nullptr;
+        SimplexSet<boundary_key_type> m_boundary;
+        SimplexSet<co_boundary_key_type> m_co_boundary;
         
     public:
         
         Simplex()
         {
-            m_boundary = new SimplexSet<boundary_key_type>();
-            m_co_boundary = new SimplexSet<co_boundary_key_type>();
+            
         }
         
-        Simplex(const Simplex& s)
+        Simplex(const Simplex& s) : m_boundary(s.m_boundary), m_co_boundary(s.m_co_boundary)
         {
-            m_boundary = new SimplexSet<boundary_key_type>(*s.m_boundary);
-            m_co_boundary = new SimplexSet<co_boundary_key_type>(*s.m_co_boundary);
+            
         }
         
-        Simplex(Simplex&& s)
+        Simplex(Simplex&& s) : m_boundary(std::move(s.m_boundary)), m_co_boundary(std::move(s.m_co_boundary))
         {
-            m_boundary = s.m_boundary;
-            m_co_boundary = s.m_co_boundary;
-            s.m_boundary = nullptr;
-            s.m_co_boundary = nullptr;
+            
         }
 
         Simplex<boundary_key_type, co_boundary_key_type>& operator=(Simplex<boundary_key_type, co_boundary_key_type>&& other){
             if (this != &other){
-                std::swap(m_boundary, other.m_boundary);
-                std::swap(m_co_boundary, other.m_co_boundary);
+                m_boundary = std::move(other.m_boundary);
+                m_co_boundary = std::move(other.m_co_boundary);
             }
             return *this;
         }
         
-        ~Simplex()
-        {
-            if(m_boundary)
-            {
-                delete m_boundary;
-            }
-            if(m_co_boundary)
-            {
-                delete m_co_boundary;
-            }
-        }
-        
     public:
         
         const SimplexSet<co_boundary_key_type>& get_co_boundary() const
         {
-            return *m_co_boundary;
+            return m_co_boundary;
         }
         const SimplexSet<boundary_key_type>& get_boundary() const
         {
-            return *m_boundary;
+            return m_boundary;
         }
         
         void add_co_face(const co_boundary_key_type& key)
         {
-            *m_co_boundary += key;
+            m_co_boundary += key;
         }
         
         void add_face(const boundary_key_type& key)
         {
-            *m_boundary += key;
+            m_boundary += key;
         }
         
         void remove_co_face(const co_boundary_key_type& key)
         {
-            *m_co_boundary -= key;
+            m_co_boundary -= key;
         }
         
         void remove_face(const boundary_key_type& key)
         {
-            *m_boundary -= key;
+            m_boundary -= key;
         }
     };
     
@@ -124,6 +107,12 @@ namespace is_mesh
             
         }
 
+        Node(const Node& other)
+        : NodeTraits(other), Simplex<Key, EdgeKey>(other)
+        {
+            
+        }
+        
         Node(Node&& other)
         :NodeTraits(std::move(other)), Simplex<Key, EdgeKey>(std::move(other))
         {}
@@ -156,6 +145,12 @@ namespace is_mesh
             
         }
 
+        Edge(const Edge& other)
+        : EdgeTraits(other), Simplex<NodeKey, FaceKey>(other)
+        {
+            
+        }
+        
         Edge(Edge&& other)
         :EdgeTraits(std::move(other)), Simplex<NodeKey, FaceKey>(std::move(other))
         {
@@ -189,6 +184,12 @@ namespace is_mesh
             
         }
 
+        Face(const Face& other)
+        : FaceTraits(other), Simplex<EdgeKey, TetrahedronKey>(other)
+        {
+            
+        }
+        
         Face(Face&& other)
         : FaceTraits(std::move(other)), Simplex<EdgeKey, TetrahedronKey>(std::move(other))
         {}
@@ -220,6 +221,12 @@ namespace is_mesh
             
         }
 
+        Tetrahedron(const Tetrahedron& other)
+        : TetrahedronTraits(other), Simplex<FaceKey, Key>(other)
+        {
+            
+        }
+        
         Tetrahedron(Tetrahedron&& other)
         :TetrahedronTraits(std::move(other)), Simplex<FaceKey, Key>(std::move(other))
         {}
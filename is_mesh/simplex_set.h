@@ -16,100 +16,185 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
 #include <vector>
 #include "key.h"
 
 namespace is_mesh
 {
     
+    /**
+     * A small ordered set of keys. Up to INLINE_SIZE keys are stored inside the set itself, so the boundary of an edge,
+     * face or tetrahedron, the co-boundary of a face and most temporary sets do not allocate memory on the heap.
+     * The keys are copied as raw memory.
+     */
     template<typename key_type>
     class SimplexSet
     {
-        std::vector<key_type> set;
+        static_assert(std::is_trivially_copyable<key_type>::value, "SimplexSet requires trivially copyable keys");
+        static const unsigned int INLINE_SIZE = 4;
+        
+        key_type* m_data;
+        unsigned int m_size = 0;
+        unsigned int m_capacity = INLINE_SIZE;
+        typename std::aligned_storage<sizeof(key_type), alignof(key_type)>::type m_inline[INLINE_SIZE];
+        
+        key_type* inline_data()
+        {
+            return reinterpret_cast<key_type*>(m_inline);
+        }
+        
+        bool is_inline() const
+        {
+            return m_data == reinterpret_cast<const key_type*>(m_inline);
+        }
+        
+        /**
+         * Makes room for at least capacity keys.
+         */
+        void reserve(unsigned int capacity)
+        {
+            if(capacity > m_capacity)
+            {
+                capacity = std::max(capacity, 2*m_capacity);
+                key_type* data = static_cast<key_type*>(::operator new(capacity*sizeof(key_type)));
+                std::memcpy(data, m_data, m_size*sizeof(key_type));
+                if(!is_inline())
+                {
+                    ::operator delete(m_data);
+                }
+                m_data = data;
+                m_capacity = capacity;
+            }
+        }
+        
+        void assign(const key_type* first, unsigned int size)
+        {
+            m_size = 0;
+            reserve(size);
+            std::memcpy(m_data, first, size*sizeof(key_type));
+            m_size = size;
+        }
+        
+        /**
+         * Takes the keys of ss and leaves ss empty.
+         */
+        void steal(SimplexSet& ss)
+        {
+            if(ss.is_inline())
+            {
+                assign(ss.m_data, ss.m_size);
+            }
+            else {
+                if(!is_inline())
+                {
+                    ::operator delete(m_data);
+                }
+                m_data = ss.m_data;
+                m_size = ss.m_size;
+                m_capacity = ss.m_capacity;
+                ss.m_data = ss.inline_data();
+                ss.m_capacity = INLINE_SIZE;
+            }
+            ss.m_size = 0;
+        }
         
     public:
         
-        SimplexSet() : set()
+        SimplexSet() : m_data(inline_data())
         {
             
         }
         
-        SimplexSet(std::initializer_list<key_type> il) : set(il)
+        SimplexSet(std::initializer_list<key_type> il) : m_data(inline_data())
         {
-            
+            assign(il.begin(), static_cast<unsigned int>(il.size()));
         }
         
-        SimplexSet(const SimplexSet& ss) : set(ss.set)
+        SimplexSet(const SimplexSet& ss) : m_data(inline_data())
         {
-            
+            assign(ss.m_data, ss.m_size);
         }
         
         SimplexSet& operator=(const SimplexSet& ss)
         {
-            set = std::vector<key_type>(ss.set);
+            if(this != &ss)
+            {
+                assign(ss.m_data, ss.m_size);
+            }
             return *this;
         }
         
-        SimplexSet(SimplexSet&& ss) : set(std::move(ss.set))
+        SimplexSet(SimplexSet&& ss) : m_data(inline_data())
         {
-            
+            steal(ss);
         }
         
         SimplexSet& operator=(SimplexSet&& ss)
         {
-            set = std::move(ss.set);
+            if(this != &ss)
+            {
+                steal(ss);
+            }
             return *this;
         }
         
         ~SimplexSet()
         {
-            
+            if(!is_inline())
+            {
+                ::operator delete(m_data);
+            }
         }
 
-        typename std::vector<key_type>::const_iterator begin() const
+        const key_type* begin() const
         {
-            return set.begin();
+            return m_data;
         }
         
-        typename std::vector<key_type>::const_iterator end() const
+        const key_type* end() const
         {
-            return set.end();
+            return m_data + m_size;
         }
         
         unsigned int size() const
         {
-            return static_cast<unsigned int>(set.size());
+            return m_size;
         }
         
         const key_type& front() const
         {
-            assert(set.size() > 0);
-            return set.front();
+            assert(m_size > 0);
+            return m_data[0];
         }
         
         const key_type& back() const
         {
-            assert(set.size() > 0);
-            return set.back();
+            assert(m_size > 0);
+            return m_data[m_size - 1];
         }
         
         const key_type& operator[](unsigned int i) const
         {
             assert(size() > i);
-            return set.at(i);
+            return m_data[i];
         }
         
         bool contains(const key_type& k) const
         {
-            return std::find(set.begin(), set.end(), k) != end();
+            return std::find(begin(), end(), k) != end();
         }
         
         int index(const key_type& k) const
         {
-            for (int i = 0; i < set.size(); i++) {
-                if(set.at(i) == k)
+            for (unsigned int i = 0; i < m_size; i++) {
+                if(m_data[i] == k)
                 {
-                    return i;
+                    return static_cast<int>(i);
                 }
             }
             return -1;
@@ -117,24 +202,28 @@ namespace is_mesh
         
         void push_front(const key_type& k)
         {
-            set.insert(set.begin(), k);
+            // k may refer to a key in this set, which is moved by reserve() and memmove().
+            const key_type key = k;
+            reserve(m_size + 1);
+            std::memmove(m_data + 1, m_data, m_size*sizeof(key_type));
+            std::memcpy(m_data, &key, sizeof(key_type));
+            m_size++;
         }
         
         void push_back(const key_type& k)
         {
-            set.push_back(k);
-        }
-        
-        void push_back(key_type&& k)
-        {
-            set.push_back(std::move(k));
+            // k may refer to a key in this set, which is moved by reserve().
+            const key_type key = k;
+            reserve(m_size + 1);
+            std::memcpy(m_data + m_size, &key, sizeof(key_type));
+            m_size++;
         }
         
         void swap(unsigned int i = 0, unsigned int j = 1)
         {
             assert(size() > i);
             assert(size() > j);
-            std::swap(set[i], set[j]);
+            std::swap(m_data[i], m_data[j]);
         }
         
         SimplexSet<key_type>& operator+=(const SimplexSet<key_type>& ss)
@@ -145,28 +234,11 @@ namespace is_mesh
             return *this;
         }
         
-        SimplexSet<key_type>& operator+=(SimplexSet<key_type>&& ss)
-        {
-            for (key_type& k : ss.set) {
-                *this += std::move(k);
-            }
-            return *this;
-        }
-        
         SimplexSet<key_type>& operator+=(const key_type& key)
         {
             if(!contains(key))
             {
-                set.push_back(key);
-            }
-            return *this;
-        }
-        
-        SimplexSet<key_type>& operator+=(key_type&& key)
-        {
-            if(!contains(key))
-            {
-                set.push_back(std::move(key));
+                push_back(key);
             }
             return *this;
         }
@@ -181,10 +253,11 @@ namespace is_mesh
         
         SimplexSet<key_type>& operator-=(const key_type& key)
         {
-            auto iter = std::find(begin(), end(), key);
-            if(iter != end())
+            key_type* iter = std::find(m_data, m_data + m_size, key);
+            if(iter != m_data + m_size)
             {
-                set.erase(iter);
+                std::memmove(iter, iter + 1, (m_data + m_size - iter - 1)*sizeof(key_type));
+                m_size--;
             }
             return *this;
         }
@@ -0,0 +1,126 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "util.h"
+
+namespace is_mesh
+{
+    /**
+     * A coarse uniform grid over the bounding box of a set of points, storing one key per cell. It is used to find a key
+     * whose position is close to a query point, e.g. as the starting point of a walk through the mesh.
+     */
+    template<typename key_type>
+    class SpatialGrid
+    {
+        vec3 min_corner;
+        vec3 cell_size;
+        int res[3] = {0, 0, 0};
+        std::vector<key_type> cells;
+
+        int cell(real x, int axis) const
+        {
+            int i = static_cast<int>(std::floor((x - min_corner[axis])/cell_size[axis]));
+            return std::max(0, std::min(res[axis] - 1, i));
+        }
+
+        int index(int i, int j, int k) const
+        {
+            return (k*res[1] + j)*res[0] + i;
+        }
+
+    public:
+        /**
+         * Builds the grid from the keys and their positions using approximately one cell per points_per_cell points.
+         */
+        void build(const std::vector<key_type>& keys, const std::vector<vec3>& points, real points_per_cell = 1.)
+        {
+            assert(keys.size() == points.size());
+            cells.clear();
+            if(keys.empty())
+            {
+                return;
+            }
+
+            vec3 max_corner = points[0];
+            min_corner = points[0];
+            for (auto& p : points)
+            {
+                for (int a = 0; a < 3; a++)
+                {
+                    min_corner[a] = std::min(min_corner[a], p[a]);
+                    max_corner[a] = std::max(max_corner[a], p[a]);
+                }
+            }
+
+            int n = std::max(1, static_cast<int>(std::cbrt(keys.size()/points_per_cell)));
+            for (int a = 0; a < 3; a++)
+            {
+                res[a] = n;
+                cell_size[a] = std::max((max_corner[a] - min_corner[a])/n, EPSILON);
+            }
+            cells = std::vector<key_type>(n*n*n);
+            for (unsigned int i = 0; i < keys.size(); i++)
+            {
+                cells[index(cell(points[i][0], 0), cell(points[i][1], 1), cell(points[i][2], 2))] = keys[i];
+            }
+        }
+
+        bool empty() const
+        {
+            return cells.empty();
+        }
+
+        /**
+         * Returns the keys stored in the cell containing p (clamped to the grid) or, if that cell is empty, in the nearest
+         * shell of cells around it that contains any keys. Returns an empty vector if the grid is empty.
+         */
+        std::vector<key_type> candidates(const vec3& p) const
+        {
+            std::vector<key_type> keys;
+            if(cells.empty())
+            {
+                return keys;
+            }
+            int c[3] = {cell(p[0], 0), cell(p[1], 1), cell(p[2], 2)};
+            int max_res = std::max(res[0], std::max(res[1], res[2]));
+            for (int r = 0; r < max_res && keys.empty(); r++)
+            {
+                for (int k = std::max(0, c[2]-r); k <= std::min(res[2]-1, c[2]+r); k++)
+                {
+                    for (int j = std::max(0, c[1]-r); j <= std::min(res[1]-1, c[1]+r); j++)
+                    {
+                        for (int i = std::max(0, c[0]-r); i <= std::min(res[0]-1, c[0]+r); i++)
+                        {
+                            bool on_shell = std::abs(i - c[0]) == r || std::abs(j - c[1]) == r || std::abs(k - c[2]) == r;
+                            const key_type& key = cells[index(i, j, k)];
+                            if(on_shell && key.is_valid())
+                            {
+                                keys.push_back(key);
+                            }
+                        }
+                    }
+                }
+            }
+            return keys;
+        }
+    };
+}
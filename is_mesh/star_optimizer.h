@@ -0,0 +1,241 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "util.h"
+
+namespace is_mesh
+{
+    /**
+     * Moves a node to maximize the minimum quality of the tetrahedra in its star, following the optimization-based smoothing
+     * of Freitag and Ollivier-Gooch. The star is given by the faces of its link. In each iteration the search direction is
+     * the steepest ascent direction of the minimum quality, that is the shortest vector in the convex hull of the quality
+     * gradients of the tetrahedra which are (nearly) the worst, and the step length is found by a line search.
+     *
+     * The link faces are stored as a structure of arrays and the qualities and their analytic gradients are computed in
+     * flat loops over the star, which the compiler can vectorize.
+     */
+    class StarOptimizer
+    {
+        // The corners of the link faces, oriented such that the tetrahedra have positive volume.
+        std::vector<real> ax, ay, az, bx, by, bz, cx, cy, cz;
+
+        // The qualities and the quality gradients of the tetrahedra at the current position.
+        std::vector<real> q, gx, gy, gz;
+
+        std::vector<unsigned int> active;
+
+        // The constant in Util::quality().
+        static constexpr real K = 8.48528;
+
+        /**
+         * Computes the quality of every tetrahedron when the node is at p and returns the minimum.
+         */
+        real evaluate(const vec3& p)
+        {
+            const size_t n = ax.size();
+            const real px = p[0], py = p[1], pz = p[2];
+            real min_q = INFINITY;
+            for (size_t i = 0; i < n; i++)
+            {
+                real ux = ax[i] - px, uy = ay[i] - py, uz = az[i] - pz;
+                real vx = bx[i] - px, vy = by[i] - py, vz = bz[i] - pz;
+                real wx = cx[i] - px, wy = cy[i] - py, wz = cz[i] - pz;
+                real v = (ux*(vy*wz - vz*wy) + uy*(vz*wx - vx*wz) + uz*(vx*wy - vy*wx))/6.;
+                real ms = (ux*ux + uy*uy + uz*uz + vx*vx + vy*vy + vz*vz + wx*wx + wy*wy + wz*wz
+                    + (ax[i]-bx[i])*(ax[i]-bx[i]) + (ay[i]-by[i])*(ay[i]-by[i]) + (az[i]-bz[i])*(az[i]-bz[i])
+                    + (ax[i]-cx[i])*(ax[i]-cx[i]) + (ay[i]-cy[i])*(ay[i]-cy[i]) + (az[i]-cz[i])*(az[i]-cz[i])
+                    + (bx[i]-cx[i])*(bx[i]-cx[i]) + (by[i]-cy[i])*(by[i]-cy[i]) + (bz[i]-cz[i])*(bz[i]-cz[i]))/6.;
+                q[i] = K*v/(ms*std::sqrt(ms));
+                min_q = Util::min(min_q, q[i]);
+            }
+            return min_q;
+        }
+
+        /**
+         * Computes the quality gradients with respect to the node position p. Assumes that evaluate(p) has been called.
+         * With the volume v and the mean squared edge length ms, the quality is K*v/ms^(3/2), so its gradient is
+         * q*(grad v/v - 3/2*grad ms/ms), where grad v = -(b-a)x(c-a)/6 and grad ms = (3p-a-b-c)/3.
+         */
+        void evaluate_gradients(const vec3& p)
+        {
+            const size_t n = ax.size();
+            const real px = p[0], py = p[1], pz = p[2];
+            for (size_t i = 0; i < n; i++)
+            {
+                real ux = bx[i] - ax[i], uy = by[i] - ay[i], uz = bz[i] - az[i];
+                real wx = cx[i] - ax[i], wy = cy[i] - ay[i], wz = cz[i] - az[i];
+                real nx = uy*wz - uz*wy, ny = uz*wx - ux*wz, nz = ux*wy - uy*wx;
+                real v = (nx*(ax[i] - px) + ny*(ay[i] - py) + nz*(az[i] - pz))/6.;
+                real mx = 3.*px - ax[i] - bx[i] - cx[i], my = 3.*py - ay[i] - by[i] - cy[i], mz = 3.*pz - az[i] - bz[i] - cz[i];
+                real ms = ((px-ax[i])*(px-ax[i]) + (py-ay[i])*(py-ay[i]) + (pz-az[i])*(pz-az[i])
+                    + (px-bx[i])*(px-bx[i]) + (py-by[i])*(py-by[i]) + (pz-bz[i])*(pz-bz[i])
+                    + (px-cx[i])*(px-cx[i]) + (py-cy[i])*(py-cy[i]) + (pz-cz[i])*(pz-cz[i])
+                    + ux*ux + uy*uy + uz*uz + wx*wx + wy*wy + wz*wz
+                    + (bx[i]-cx[i])*(bx[i]-cx[i]) + (by[i]-cy[i])*(by[i]-cy[i]) + (bz[i]-cz[i])*(bz[i]-cz[i]))/6.;
+                real sv = -q[i]/(6.*v);
+                real sm = -0.5*q[i]/ms;
+                gx[i] = sv*nx + sm*mx;
+                gy[i] = sv*ny + sm*my;
+                gz[i] = sv*nz + sm*mz;
+            }
+        }
+
+        vec3 gradient(unsigned int i) const
+        {
+            return vec3(gx[i], gy[i], gz[i]);
+        }
+
+        /**
+         * Returns the shortest vector in the convex hull of the gradients of the active tetrahedra, found by Gilbert's
+         * algorithm. A zero vector means that the position is optimal.
+         */
+        vec3 search_direction() const
+        {
+            vec3 d = gradient(active[0]);
+            for (auto i : active)
+            {
+                if (Util::sqr_length(gradient(i)) < Util::sqr_length(d))
+                {
+                    d = gradient(i);
+                }
+            }
+            for (int iteration = 0; iteration < 20; iteration++)
+            {
+                unsigned int j = active[0];
+                for (auto i : active)
+                {
+                    if (Util::dot(gradient(i), d) < Util::dot(gradient(j), d))
+                    {
+                        j = i;
+                    }
+                }
+                vec3 e = d - gradient(j);
+                real gap = Util::dot(d, e);
+                if (gap <= 1e-12*Util::sqr_length(d))
+                {
+                    break;
+                }
+                d -= Util::min(gap/Util::sqr_length(e), 1.)*e;
+            }
+            return d;
+        }
+
+    public:
+        void clear()
+        {
+            for (auto v : {&ax, &ay, &az, &bx, &by, &bz, &cx, &cy, &cz})
+            {
+                v->clear();
+            }
+        }
+
+        /**
+         * Adds the tetrahedron spanned by the link face with the corners a, b and c and the node at p.
+         */
+        void add_face(const vec3& a, const vec3& b, const vec3& c, const vec3& p)
+        {
+            vec3 b_ = b, c_ = c;
+            if (Util::signed_volume<real>(a, b, c, p) < 0.)
+            {
+                std::swap(b_, c_);
+            }
+            ax.push_back(a[0]); ay.push_back(a[1]); az.push_back(a[2]);
+            bx.push_back(b_[0]); by.push_back(b_[1]); bz.push_back(b_[2]);
+            cx.push_back(c_[0]); cy.push_back(c_[1]); cz.push_back(c_[2]);
+        }
+
+        /**
+         * Returns the minimum quality of the star when the node is at p. The quality is negative if a tetrahedron is inverted
+         * with respect to the orientation given to add_face().
+         */
+        real min_quality(const vec3& p)
+        {
+            q.resize(ax.size());
+            return evaluate(p);
+        }
+
+        /**
+         * Moves p to increase the minimum quality of the star by at most max_iterations steps and returns the minimum quality
+         * at the new p. The minimum quality never decreases.
+         */
+        real optimize(vec3& p, int max_iterations = 10, real active_tolerance = 1e-3)
+        {
+            const size_t n = ax.size();
+            q.resize(n);
+            gx.resize(n);
+            gy.resize(n);
+            gz.resize(n);
+            real m = evaluate(p);
+            for (int iteration = 0; iteration < max_iterations && m > 0.; iteration++)
+            {
+                evaluate_gradients(p);
+                active.clear();
+                for (unsigned int i = 0; i < n; i++)
+                {
+                    if (q[i] - m < active_tolerance)
+                    {
+                        active.push_back(i);
+                    }
+                }
+
+                vec3 d = search_direction();
+                real dd = Util::sqr_length(d);
+                if (dd < 1e-20)
+                {
+                    break;
+                }
+
+                // The linear model predicts that the minimum is taken over by the inactive tetrahedron with the smallest
+                // step where its quality meets the quality of the active set, and the step is never longer than where the
+                // active set would reach the maximal quality 1.
+                real alpha = (1. - m)/dd;
+                for (unsigned int i = 0; i < n; i++)
+                {
+                    real slope = Util::dot(gradient(i), d);
+                    if (q[i] - m >= active_tolerance && slope < dd)
+                    {
+                        alpha = Util::min(alpha, (q[i] - m)/(dd - slope));
+                    }
+                }
+
+                bool improved = false;
+                for (int halvings = 0; halvings < 10 && !improved; halvings++)
+                {
+                    vec3 p_new = p + alpha*d;
+                    real m_new = evaluate(p_new);
+                    if (m_new > m)
+                    {
+                        p = p_new;
+                        m = m_new;
+                        improved = true;
+                    }
+                    alpha *= 0.5;
+                }
+                if (!improved)
+                {
+                    break;
+                }
+            }
+            return m;
+        }
+    };
+}
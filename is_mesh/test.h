@@ -16,15 +16,24 @@
 
 #pragma once
 
+#include <random>
+
 #include "util.h"
+#include "simplex_set.h"
+#include "klincsek_table.h"
+#include "paged_array.h"
+#include "tet_mesh.h"
+#include "op_log.h"
+
+using namespace is_mesh;
 
 
 inline void test_distance_triangle_triangle()
 {
     std::cout << "Testing utility functions:";
-    real d = distance_triangle_triangle<real>(vec3(0.), vec3(0., 1., 0.), vec3(1., 0., 0.), vec3(1., 1., -1.), vec3(1.,1.,2.), vec3(4., 2., 4.));
+    real d = Util::distance_triangle_triangle<real>(vec3(0.), vec3(0., 1., 0.), vec3(1., 0., 0.), vec3(1., 1., -1.), vec3(1.,1.,2.), vec3(4., 2., 4.));
     assert(abs(d - sqrt(2.)/2) < EPSILON);
-    d = distance_triangle_triangle<real>(vec3(0.), vec3(0., 1., 0.), vec3(1., 0., 0.), vec3(1., 1., 0.), vec3(4.,1.,2.), vec3(4., 2., 4.));
+    d = Util::distance_triangle_triangle<real>(vec3(0.), vec3(0., 1., 0.), vec3(1., 0., 0.), vec3(1., 1., 0.), vec3(4.,1.,2.), vec3(4., 2., 4.));
     assert(abs(d - sqrt(2.)/2) < EPSILON);
     std::cout << " PASSED" << std::endl;
 }
@@ -50,5 +59,310 @@ inline void simplex_set_test()
     SimplexSet<int> E = {1,9,4,11};
     assert(A == E);
     
+    // Growing past the inline storage
+    SimplexSet<int> G;
+    for (int i = 0; i < 20; i++) {
+        G.push_back(i);
+    }
+    assert(G.size() == 20);
+    for (int i = 0; i < 20; i++) {
+        assert(G[i] == i);
+    }
+    G.push_front(-1);
+    assert(G.size() == 21 && G.front() == -1 && G[1] == 0 && G.back() == 19);
+    
+    // Pushing a key of the set itself
+    SimplexSet<int> P = {1,2,3,4};
+    P.push_back(P[0]);
+    P.push_front(P[4]);
+    assert(P.size() == 6 && P.front() == 1 && P[1] == 1 && P[4] == 4 && P.back() == 1);
+    
+    // Copy and move between inline and heap sets
+    SimplexSet<int> H = {1,2,3,4,5,6,7,8};
+    SimplexSet<int> S = {1,2};
+    SimplexSet<int> H_copy = H;
+    assert(H_copy == H);
+    S = H;
+    assert(S == H && S.size() == 8);
+    SimplexSet<int> T = {1,2};
+    H_copy = T;
+    assert(H_copy == T && H_copy.size() == 2);
+    H_copy.push_back(3);
+    assert(T.size() == 2);
+    
+    SimplexSet<int> M = std::move(S);
+    assert(M == H && S.size() == 0);
+    S.push_back(5);
+    assert(S.size() == 1 && S.front() == 5);
+    SimplexSet<int> N = {9,10};
+    N = std::move(M);
+    assert(N == H && M.size() == 0);
+    SimplexSet<int> O = std::move(T);
+    assert(O.size() == 2 && T.size() == 0);
+    N = std::move(O);
+    assert(N.size() == 2 && N.contains(1) && N.contains(2));
+    
+    // Set operations across the inline and heap storage
+    SimplexSet<int> X = {1,2,3};
+    SimplexSet<int> Y = {2,3,4,5,6,7,8};
+    X += Y;
+    SimplexSet<int> XY = {1,2,3,4,5,6,7,8};
+    assert(X == XY);
+    X -= Y;
+    SimplexSet<int> X1 = {1};
+    assert(X == X1);
+    Y -= SimplexSet<int>({4,5,6,7});
+    SimplexSet<int> Y1 = {2,3,8};
+    assert(Y == Y1);
+    
+    SimplexSet<int> Z = {2,4,6,8,10,12};
+    SimplexSet<int> W = {1,2,3,4};
+    SimplexSet<int> ZW = {2,4};
+    assert((Z&W) == ZW);
+    assert((W&Z) == ZW);
+    assert((SimplexSet<int>(Z)&W) == ZW);
+    assert((Z+W).size() == 8);
+    assert((Z-W) == SimplexSet<int>({6,8,10,12}));
+    assert((W-Z) == SimplexSet<int>({1,3}));
+    
+    std::cout << "PASSED" << std::endl;
+}
+
+/**
+ * Compares the Klincsek table with the dynamic program evaluated directly by Util::quality() on random polygons around an edge.
+ */
+inline void klincsek_table_test()
+{
+    std::cout << "Testing Klincsek table: ";
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<real> uniform(0., 1.);
+    vec3 a(0., 0., -1.), b(0., 0., 1.);
+    KlincsekTable table;
+    for (int test = 0; test < 200; test++)
+    {
+        const int m = 3 + test%10;
+        std::vector<vec3> polygon;
+        table.clear();
+        for (int i = 0; i < m; i++)
+        {
+            real angle = 2.*M_PI*(i + 0.8*uniform(gen))/m;
+            real radius = 0.5 + uniform(gen);
+            polygon.push_back(vec3(radius*cos(angle), radius*sin(angle), 0.6*(uniform(gen) - 0.5)));
+            table.push_back(polygon.back());
+        }
+        table.build(a, b);
+        
+        std::vector<std::vector<real>> Q(m-1, std::vector<real>(m, 0.));
+        for (int i = 0; i < m-1; i++)
+        {
+            Q[i][i+1] = INFINITY;
+        }
+        for (int i = m-3; i >= 0; i--)
+        {
+            for (int j = i+2; j < m; j++)
+            {
+                std::vector<real> q(m);
+                for (int k = i+1; k < j; k++)
+                {
+                    q[k] = Util::min(Util::quality<real>(polygon[i], polygon[k], a, polygon[j]), Util::quality<real>(polygon[k], polygon[i], b, polygon[j]));
+                    if (k < j-1)
+                    {
+                        q[k] = Util::min(q[k], Q[k][j]);
+                    }
+                    if (k > i+1)
+                    {
+                        q[k] = Util::min(q[k], Q[i][k]);
+                    }
+                    if (k == i+1 || q[k] > Q[i][j])
+                    {
+                        Q[i][j] = q[k];
+                    }
+                }
+                
+                // The split vertex must give the best quality, but may differ from the direct evaluation at ties.
+                assert(std::abs(table.quality(i, j) - Q[i][j]) < 1e-10);
+                int k = table(i, j);
+                assert(i < k && k < j);
+                assert(std::abs(q[k] - Q[i][j]) < 1e-10);
+            }
+        }
+    }
+    std::cout << "PASSED" << std::endl;
+}
+
+inline void paged_array_test()
+{
+    std::cout << "Testing paged array: ";
+    PagedArray<int> a;
+    a.resize(3000, -1);
+    assert(a.size() == 3000 && a[0] == -1 && a[2999] == -1);
+    for (int i = 0; i < 3000; i++)
+    {
+        a.write(i) = i;
+    }
+    
+    // A copy shares the pages until either is written.
+    PagedArray<int> b(a);
+    assert(b.is_shared(0) && a.is_shared(2999));
+    b.write(5) = -5;
+    assert(a[5] == 5 && b[5] == -5);
+    assert(!b.is_shared(5) && !a.is_shared(5) && a.is_shared(2000));
+    a.push_back(3000);
+    assert(a.size() == 3001 && b.size() == 3000 && a.back() == 3000);
+    
+    // Shrinking and growing again sets the new values.
+    a.resize(10);
+    a.resize(2000, 7);
+    assert(a[9] == 9 && a[10] == 7 && a[1999] == 7 && b[10] == 10 && b[1999] == 1999);
+    a.pop_back();
+    assert(a.size() == 1999);
+    
+    int sum = 0;
+    for (auto v : a)
+    {
+        sum += v;
+    }
+    assert(sum == 45 + 7*1989);
+    
+    PagedArray<int> e(b);
+    assert(e.detach() == 3 && !b.is_shared(1000) && e[5] == -5);
+    
+    PagedArray<bool> c;
+    c.resize(2000, false);
+    PagedArray<bool> d(c);
+    d.write(1500) = true;
+    assert(!c[1500] && d[1500]);
+    std::cout << "PASSED" << std::endl;
+}
+
+/**
+ * Returns the Euler characteristic of mesh, which is 1 for a ball.
+ */
+inline int euler_characteristic(TetMesh& mesh)
+{
+    return static_cast<int>(mesh.get_no_nodes()) - static_cast<int>(mesh.get_no_edges()) + static_cast<int>(mesh.get_no_faces()) - static_cast<int>(mesh.get_no_tets());
+}
+
+/**
+ * Applies each operation of TetMesh to small convex meshes and checks the neighbours, seeds and orientations afterwards.
+ */
+inline void tet_mesh_test()
+{
+    std::cout << "Testing tet mesh: ";
+
+    // An octahedron of four tetrahedra around the edge between nodes 4 and 5.
+    std::vector<vec3> points = {vec3(1., 0., 0.), vec3(0., 1., 0.), vec3(-1., 0., 0.), vec3(0., -1., 0.), vec3(0., 0., -1.), vec3(0., 0., 1.)};
+    std::vector<int> tets = {4,5,0,1, 4,5,1,2, 4,5,2,3, 4,5,3,0};
+    TetMesh mesh(points, tets, std::vector<int>(4, 0));
+    mesh.validity_check();
+    assert(mesh.get_no_nodes() == 6 && mesh.get_no_edges() == 13 && mesh.get_no_faces() == 12 && mesh.get_no_tets() == 4);
+    assert(euler_characteristic(mesh) == 1);
+    assert(mesh.get_tets(TetMeshEdge(4, 5)).size() == 4 && mesh.get_tets(NodeKey(0)).size() == 2);
+    assert(!mesh.is_boundary(TetMeshFace(4, 5, 0)) && mesh.is_boundary(TetMeshFace(5, 0, 1)));
+    assert(!mesh.is_boundary(TetMeshEdge(4, 5)) && mesh.is_boundary(NodeKey(0)));
+
+    mesh.set_label(mesh.get_tets(TetMeshFace(4, 5, 1)).front(), 1);
+    assert(mesh.is_interface(TetMeshFace(4, 5, 1)) && !mesh.is_interface(TetMeshFace(4, 5, 3)));
+    assert(mesh.is_interface(TetMeshEdge(4, 5)) && mesh.is_interface(NodeKey(0)) == mesh.is_interface(TetMeshFace(4, 5, 0)));
+    mesh.set_label(mesh.get_tets(TetMeshFace(4, 5, 1)).front(), 0);
+
+    mesh.flip_44(TetMeshFace(4, 5, 0), TetMeshFace(4, 5, 2));
+    mesh.validity_check();
+    assert(!mesh.exists(TetMeshEdge(4, 5)) && mesh.get_tets(TetMeshEdge(0, 2)).size() == 4);
+    mesh.flip(TetMeshEdge(0, 2), TetMeshFace(0, 2, 4), TetMeshFace(0, 2, 5));
+    mesh.validity_check();
+    assert(mesh.exists(TetMeshEdge(4, 5)) && !mesh.exists(TetMeshEdge(0, 2)) && euler_characteristic(mesh) == 1);
+
+    NodeKey nid = mesh.split(TetMeshEdge(4, 5), vec3(0.), vec3(0.));
+    mesh.validity_check();
+    assert(mesh.get_no_nodes() == 7 && mesh.get_no_tets() == 8 && euler_characteristic(mesh) == 1);
+    assert(mesh.get_tets(nid).size() == 8 && !mesh.is_boundary(nid) && mesh.get_edges(nid).size() == 6);
+    mesh.collapse(TetMeshEdge(nid, 4), NodeKey(4), 0.);
+    mesh.validity_check();
+    assert(mesh.get_no_nodes() == 6 && mesh.get_no_tets() == 4 && !mesh.exists(nid) && euler_characteristic(mesh) == 1);
+    assert(mesh.get_pos(NodeKey(4)) == vec3(0., 0., -1.) && mesh.get_tets(TetMeshEdge(4, 5)).size() == 4);
+
+    // Two tetrahedra sharing a triangle pierced by the edge between their apexes.
+    points = {vec3(1., 0., 0.), vec3(-0.5, 1., 0.), vec3(-0.5, -1., 0.), vec3(0., 0., 1.), vec3(0., 0., -1.)};
+    tets = {0,1,2,3, 0,1,2,4};
+    TetMesh bipyramid(points, tets, std::vector<int>(2, 0));
+    TetMeshEdge eid = bipyramid.flip_23(TetMeshFace(0, 1, 2));
+    bipyramid.validity_check();
+    assert(eid == TetMeshEdge(3, 4) && bipyramid.get_no_tets() == 3 && !bipyramid.exists(TetMeshFace(0, 1, 2)));
+    TetMeshFace fid = bipyramid.flip_32(eid);
+    bipyramid.validity_check();
+    assert(fid == TetMeshFace(0, 1, 2) && bipyramid.get_no_tets() == 2 && euler_characteristic(bipyramid) == 1);
+
+    // A square pyramid with the diagonal between nodes 0 and 2 on the boundary.
+    points = {vec3(-1., -1., 0.), vec3(1., -1., 0.), vec3(1., 1., 0.), vec3(-1., 1., 0.), vec3(0., 0., 1.)};
+    tets = {0,1,2,4, 0,2,3,4};
+    TetMesh pyramid(points, tets, std::vector<int>(2, 0));
+    pyramid.flip_22(TetMeshFace(0, 1, 2), TetMeshFace(0, 2, 3));
+    pyramid.validity_check();
+    assert(!pyramid.exists(TetMeshEdge(0, 2)) && pyramid.get_tets(TetMeshEdge(1, 3)).size() == 2 && euler_characteristic(pyramid) == 1);
+
+    std::cout << "PASSED" << std::endl;
+}
+
+/**
+ * Records one deform() step of the deformable simplicial complex dsc, in which the interface moves along its normals, and
+ * replays it on a copy of dsc. The replay must reproduce the exact keys, positions and labels.
+ */
+template<typename dsc_type>
+inline void replay_test(dsc_type& dsc)
+{
+    std::cout << "Testing record and replay: ";
+    for (auto nit = dsc.nodes_begin(); nit != dsc.nodes_end(); nit++)
+    {
+        if(dsc.is_movable(nit.key()))
+        {
+            dsc.set_destination(nit.key(), nit->get_pos() + 0.5*dsc.get_avg_edge_length()*dsc.get_normal(nit.key()));
+        }
+    }
+    dsc_type copy(dsc);
+    
+    OpLog log;
+    dsc.record(&log);
+    dsc.deform(1);
+    dsc.record(nullptr);
+    assert(log.size() > 0);
+    copy.replay(log);
+    
+    assert(dsc.get_no_nodes() == copy.get_no_nodes());
+    assert(dsc.get_no_edges() == copy.get_no_edges());
+    assert(dsc.get_no_faces() == copy.get_no_faces());
+    assert(dsc.get_no_tets() == copy.get_no_tets());
+    
+    auto n2 = copy.nodes_begin();
+    for (auto n1 = dsc.nodes_begin(); n1 != dsc.nodes_end(); n1++, n2++)
+    {
+        assert(n1.key() == n2.key());
+        assert(n1->get_pos() == n2->get_pos());
+    }
+    
+    auto e2 = copy.edges_begin();
+    for (auto e1 = dsc.edges_begin(); e1 != dsc.edges_end(); e1++, e2++)
+    {
+        assert(e1.key() == e2.key());
+    }
+    
+    auto f2 = copy.faces_begin();
+    for (auto f1 = dsc.faces_begin(); f1 != dsc.faces_end(); f1++, f2++)
+    {
+        assert(f1.key() == f2.key());
+    }
+    
+    auto t2 = copy.tetrahedra_begin();
+    for (auto t1 = dsc.tetrahedra_begin(); t1 != dsc.tetrahedra_end(); t1++, t2++)
+    {
+        assert(t1.key() == t2.key());
+        assert(dsc.get_label(t1.key()) == copy.get_label(t2.key()));
+        auto nids1 = dsc.get_nodes(t1.key());
+        auto nids2 = copy.get_nodes(t2.key());
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            assert(nids1[i] == nids2[i]);
+        }
+    }
     std::cout << "PASSED" << std::endl;
-}
\ No newline at end of file
+}
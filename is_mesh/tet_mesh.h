@@ -0,0 +1,1044 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <vector>
+
+#include "util.h"
+#include "key.h"
+#include "simplex_set.h"
+
+namespace is_mesh
+{
+    /**
+     * An edge of a TetMesh. Edges are not stored, an edge is given by its two nodes in increasing order.
+     */
+    struct TetMeshEdge
+    {
+        NodeKey nids[2];
+
+        TetMeshEdge()
+        {
+
+        }
+
+        TetMeshEdge(const NodeKey& a, const NodeKey& b)
+        {
+            nids[0] = static_cast<size_t>(a) < static_cast<size_t>(b) ? a : b;
+            nids[1] = static_cast<size_t>(a) < static_cast<size_t>(b) ? b : a;
+        }
+
+        friend bool operator==(const TetMeshEdge& e1, const TetMeshEdge& e2)
+        {
+            return e1.nids[0] == e2.nids[0] && e1.nids[1] == e2.nids[1];
+        }
+
+        friend bool operator<(const TetMeshEdge& e1, const TetMeshEdge& e2)
+        {
+            return std::lexicographical_compare(e1.nids, e1.nids + 2, e2.nids, e2.nids + 2);
+        }
+    };
+
+    /**
+     * A face of a TetMesh. Faces are not stored, a face is given by its three nodes in increasing order.
+     */
+    struct TetMeshFace
+    {
+        NodeKey nids[3];
+
+        TetMeshFace()
+        {
+
+        }
+
+        TetMeshFace(const NodeKey& a, const NodeKey& b, const NodeKey& c)
+        {
+            nids[0] = a;
+            nids[1] = b;
+            nids[2] = c;
+            std::sort(nids, nids + 3);
+        }
+
+        bool contains(const NodeKey& nid) const
+        {
+            return nids[0] == nid || nids[1] == nid || nids[2] == nid;
+        }
+
+        friend bool operator==(const TetMeshFace& f1, const TetMeshFace& f2)
+        {
+            return f1.nids[0] == f2.nids[0] && f1.nids[1] == f2.nids[1] && f1.nids[2] == f2.nids[2];
+        }
+
+        friend bool operator<(const TetMeshFace& f1, const TetMeshFace& f2)
+        {
+            return std::lexicographical_compare(f1.nids, f1.nids + 3, f2.nids, f2.nids + 3);
+        }
+    };
+
+    /**
+     * A compact tetrahedral mesh which only stores the four nodes, the four neighbours and the label of each tetrahedron,
+     * and the position, destination and one incident tetrahedron (the seed) of each node. Edges and faces are not stored
+     * but derived from their nodes, see TetMeshEdge and TetMeshFace, and the star of a node is found by walking through
+     * the neighbours from its seed. The interface and boundary flags are derived from the labels and the neighbours.
+     *
+     * It provides the getters and the split, collapse and flip operations of ISMesh at about 50 bytes per tetrahedron,
+     * instead of the several hundred bytes of the explicit incidence structure. The nodes of every tetrahedron are stored
+     * in positive order (positive signed volume) and all operations preserve this order combinatorially.
+     */
+    class TetMesh
+    {
+        struct tet
+        {
+            // The nodes in positive order, or invalid if the tetrahedron is removed.
+            NodeKey nodes[4];
+            // The neighbour opposite each node, or invalid on the boundary.
+            TetrahedronKey neighbours[4];
+            int label = 0;
+        };
+
+        struct node
+        {
+            vec3 pos;
+            vec3 destination;
+            // A tetrahedron incident to the node, or invalid if the node is removed.
+            TetrahedronKey seed;
+        };
+
+        std::vector<tet> m_tets;
+        std::vector<node> m_nodes;
+        std::vector<TetrahedronKey> m_free_tets;
+        std::vector<NodeKey> m_free_nodes;
+        size_t m_no_tets = 0;
+        size_t m_no_nodes = 0;
+
+    public:
+        /**
+         * Creates the mesh from the points and the tetrahedra given as four point indices each, like ISMesh. Every face may
+         * be shared by at most two tetrahedra.
+         */
+        TetMesh(const std::vector<vec3>& points, const std::vector<int>& tets, const std::vector<int>& tet_labels)
+        {
+            for (auto& p : points)
+            {
+                insert_node(p, p);
+            }
+            for (unsigned int i = 0; 4*i < tets.size(); i++)
+            {
+                std::array<NodeKey, 4> nids = {{NodeKey(tets[4*i]), NodeKey(tets[4*i+1]), NodeKey(tets[4*i+2]), NodeKey(tets[4*i+3])}};
+                if(Util::signed_volume<real>(get_pos(nids[0]), get_pos(nids[1]), get_pos(nids[2]), get_pos(nids[3])) < 0.)
+                {
+                    std::swap(nids[2], nids[3]);
+                }
+                insert_tet(nids, i < tet_labels.size() ? tet_labels[i] : 0);
+            }
+
+            // Connects the tetrahedra sharing a face.
+            std::vector<std::pair<TetMeshFace, std::pair<TetrahedronKey, int>>> faces;
+            for (size_t t = 0; t < m_tets.size(); t++)
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    faces.push_back({face(TetrahedronKey(t), i), {TetrahedronKey(t), i}});
+                }
+            }
+            std::sort(faces.begin(), faces.end(), [](const std::pair<TetMeshFace, std::pair<TetrahedronKey, int>>& a, const std::pair<TetMeshFace, std::pair<TetrahedronKey, int>>& b) {
+                return a.first < b.first;
+            });
+            for (size_t i = 0; i + 1 < faces.size(); i++)
+            {
+                if(faces[i].first == faces[i+1].first)
+                {
+#ifdef DEBUG
+                    assert(i + 2 == faces.size() || !(faces[i+2].first == faces[i].first));
+#endif
+                    m_tets[faces[i].second.first].neighbours[faces[i].second.second] = faces[i+1].second.first;
+                    m_tets[faces[i+1].second.first].neighbours[faces[i+1].second.second] = faces[i].second.first;
+                    i++;
+                }
+            }
+
+            // Points which are not used by any tetrahedron are not part of the mesh.
+            for (size_t n = 0; n < m_nodes.size(); n++)
+            {
+                if(!m_nodes[n].seed.is_valid())
+                {
+                    remove_node(NodeKey(n));
+                }
+            }
+        }
+
+        size_t get_no_nodes() const
+        {
+            return m_no_nodes;
+        }
+
+        size_t get_no_tets() const
+        {
+            return m_no_tets;
+        }
+
+        /**
+         * Returns the number of faces, each interior face counted once.
+         */
+        size_t get_no_faces() const
+        {
+            size_t no_sides = 0, no_boundary = 0;
+            for (size_t t = 0; t < m_tets.size(); t++)
+            {
+                if(exists(TetrahedronKey(t)))
+                {
+                    for (auto n : m_tets[t].neighbours)
+                    {
+                        no_sides++;
+                        no_boundary += n.is_valid() ? 0 : 1;
+                    }
+                }
+            }
+            return (no_sides + no_boundary)/2;
+        }
+
+        size_t get_no_edges()
+        {
+            size_t no_edges = 0;
+            for (size_t n = 0; n < m_nodes.size(); n++)
+            {
+                if(exists(NodeKey(n)))
+                {
+                    for (auto e : get_edges(NodeKey(n)))
+                    {
+                        no_edges += e.nids[0] == NodeKey(n) ? 1 : 0;
+                    }
+                }
+            }
+            return no_edges;
+        }
+
+        /**
+         * Returns the number of bytes allocated by the mesh.
+         */
+        size_t get_memory_usage() const
+        {
+            return m_tets.capacity()*sizeof(tet) + m_nodes.capacity()*sizeof(node) + m_free_tets.capacity()*sizeof(TetrahedronKey)
+                + m_free_nodes.capacity()*sizeof(NodeKey);
+        }
+
+        //////////////////////
+        // GETTER FUNCTIONS //
+        //////////////////////
+
+        bool exists(const NodeKey& nid) const
+        {
+            return static_cast<size_t>(nid) < m_nodes.size() && m_nodes[nid].seed.is_valid();
+        }
+
+        bool exists(const TetrahedronKey& tid) const
+        {
+            return static_cast<size_t>(tid) < m_tets.size() && m_tets[tid].nodes[0].is_valid();
+        }
+
+        bool exists(const TetMeshEdge& eid) const
+        {
+            return exists(eid.nids[0]) && exists(eid.nids[1]) && get_tets(eid).size() > 0;
+        }
+
+        bool exists(const TetMeshFace& fid) const
+        {
+            return exists(fid.nids[0]) && exists(fid.nids[1]) && exists(fid.nids[2]) && get_tets(fid).size() > 0;
+        }
+
+        const vec3& get_pos(const NodeKey& nid) const
+        {
+            return m_nodes[nid].pos;
+        }
+
+        void set_pos(const NodeKey& nid, const vec3& p)
+        {
+            m_nodes[nid].pos = p;
+        }
+
+        const vec3& get_destination(const NodeKey& nid) const
+        {
+            return m_nodes[nid].destination;
+        }
+
+        void set_destination(const NodeKey& nid, const vec3& p)
+        {
+            m_nodes[nid].destination = p;
+        }
+
+        int get_label(const TetrahedronKey& tid) const
+        {
+            return m_tets[tid].label;
+        }
+
+        void set_label(const TetrahedronKey& tid, int label)
+        {
+            m_tets[tid].label = label;
+        }
+
+        SimplexSet<NodeKey> get_nodes(const TetrahedronKey& tid) const
+        {
+            const tet& t = m_tets[tid];
+            return {t.nodes[0], t.nodes[1], t.nodes[2], t.nodes[3]};
+        }
+
+        SimplexSet<NodeKey> get_nodes(const TetMeshFace& fid) const
+        {
+            return {fid.nids[0], fid.nids[1], fid.nids[2]};
+        }
+
+        SimplexSet<NodeKey> get_nodes(const TetMeshEdge& eid) const
+        {
+            return {eid.nids[0], eid.nids[1]};
+        }
+
+        /**
+         * Returns the neighbour of the tetrahedron tid opposite its node nid, or an invalid key on the boundary.
+         */
+        TetrahedronKey get_neighbour(const TetrahedronKey& tid, const NodeKey& nid) const
+        {
+            return m_tets[tid].neighbours[index(tid, nid)];
+        }
+
+        /**
+         * Returns the tetrahedra incident to the node nid by walking through the neighbours from the seed of nid.
+         */
+        SimplexSet<TetrahedronKey> get_tets(const NodeKey& nid) const
+        {
+            SimplexSet<TetrahedronKey> tids = {m_nodes[nid].seed};
+            for (unsigned int i = 0; i < tids.size(); i++)
+            {
+                const tet& t = m_tets[tids[i]];
+                for (int j = 0; j < 4; j++)
+                {
+                    if(t.nodes[j] != nid && t.neighbours[j].is_valid() && !tids.contains(t.neighbours[j]))
+                    {
+                        tids.push_back(t.neighbours[j]);
+                    }
+                }
+            }
+            return tids;
+        }
+
+        SimplexSet<TetrahedronKey> get_tets(const TetMeshEdge& eid) const
+        {
+            SimplexSet<TetrahedronKey> tids;
+            for (auto t : get_tets(eid.nids[0]))
+            {
+                if(index(t, eid.nids[1]) >= 0)
+                {
+                    tids.push_back(t);
+                }
+            }
+            return tids;
+        }
+
+        SimplexSet<TetrahedronKey> get_tets(const TetMeshFace& fid) const
+        {
+            SimplexSet<TetrahedronKey> tids;
+            for (auto t : get_tets(TetMeshEdge(fid.nids[0], fid.nids[1])))
+            {
+                int i = index(t, fid.nids[2]);
+                if(i >= 0)
+                {
+                    tids.push_back(t);
+                    TetrahedronKey n = m_tets[t].neighbours[opposite(t, fid)];
+                    if(n.is_valid())
+                    {
+                        tids.push_back(n);
+                    }
+                    break;
+                }
+            }
+            return tids;
+        }
+
+        std::vector<TetMeshEdge> get_edges(const TetrahedronKey& tid) const
+        {
+            const tet& t = m_tets[tid];
+            return {TetMeshEdge(t.nodes[0], t.nodes[1]), TetMeshEdge(t.nodes[0], t.nodes[2]), TetMeshEdge(t.nodes[0], t.nodes[3]),
+                TetMeshEdge(t.nodes[1], t.nodes[2]), TetMeshEdge(t.nodes[1], t.nodes[3]), TetMeshEdge(t.nodes[2], t.nodes[3])};
+        }
+
+        std::vector<TetMeshEdge> get_edges(const TetMeshFace& fid) const
+        {
+            return {TetMeshEdge(fid.nids[0], fid.nids[1]), TetMeshEdge(fid.nids[0], fid.nids[2]), TetMeshEdge(fid.nids[1], fid.nids[2])};
+        }
+
+        std::vector<TetMeshEdge> get_edges(const NodeKey& nid) const
+        {
+            SimplexSet<NodeKey> nids;
+            for (auto t : get_tets(nid))
+            {
+                for (auto n : m_tets[t].nodes)
+                {
+                    if(n != nid && !nids.contains(n))
+                    {
+                        nids.push_back(n);
+                    }
+                }
+            }
+            std::vector<TetMeshEdge> eids;
+            for (auto n : nids)
+            {
+                eids.push_back(TetMeshEdge(nid, n));
+            }
+            return eids;
+        }
+
+        std::vector<TetMeshFace> get_faces(const TetrahedronKey& tid) const
+        {
+            return {face(tid, 0), face(tid, 1), face(tid, 2), face(tid, 3)};
+        }
+
+        std::vector<TetMeshFace> get_faces(const TetMeshEdge& eid) const
+        {
+            std::vector<TetMeshFace> fids;
+            for (auto t : get_tets(eid))
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    NodeKey n = m_tets[t].nodes[i];
+                    if(n != eid.nids[0] && n != eid.nids[1])
+                    {
+                        TetMeshFace f = face(t, i);
+                        if(std::find(fids.begin(), fids.end(), f) == fids.end())
+                        {
+                            fids.push_back(f);
+                        }
+                    }
+                }
+            }
+            return fids;
+        }
+
+        std::vector<TetMeshFace> get_faces(const NodeKey& nid) const
+        {
+            std::vector<TetMeshFace> fids;
+            for (auto t : get_tets(nid))
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    if(m_tets[t].nodes[i] != nid)
+                    {
+                        TetMeshFace f = face(t, i);
+                        if(std::find(fids.begin(), fids.end(), f) == fids.end())
+                        {
+                            fids.push_back(f);
+                        }
+                    }
+                }
+            }
+            return fids;
+        }
+
+        ///////////
+        // FLAGS //
+        ///////////
+
+        /**
+         * Returns whether the face fid is on the boundary of the domain, i.e. has only one tetrahedron.
+         */
+        bool is_boundary(const TetMeshFace& fid) const
+        {
+            return get_tets(fid).size() == 1;
+        }
+
+        /**
+         * Returns whether the face fid separates two tetrahedra with different labels.
+         */
+        bool is_interface(const TetMeshFace& fid) const
+        {
+            SimplexSet<TetrahedronKey> tids = get_tets(fid);
+            return tids.size() == 2 && get_label(tids[0]) != get_label(tids[1]);
+        }
+
+        bool is_boundary(const TetMeshEdge& eid) const
+        {
+            for (auto t : get_tets(eid))
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    NodeKey n = m_tets[t].nodes[i];
+                    if(n != eid.nids[0] && n != eid.nids[1] && !m_tets[t].neighbours[i].is_valid())
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        bool is_interface(const TetMeshEdge& eid) const
+        {
+            SimplexSet<TetrahedronKey> tids = get_tets(eid);
+            for (auto t : tids)
+            {
+                if(get_label(t) != get_label(tids[0]))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool is_boundary(const NodeKey& nid) const
+        {
+            for (auto t : get_tets(nid))
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    if(m_tets[t].nodes[i] != nid && !m_tets[t].neighbours[i].is_valid())
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        bool is_interface(const NodeKey& nid) const
+        {
+            SimplexSet<TetrahedronKey> tids = get_tets(nid);
+            for (auto t : tids)
+            {
+                if(get_label(t) != get_label(tids[0]))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        ////////////////
+        // OPERATIONS //
+        ////////////////
+
+        /**
+         * Splits the edge eid by inserting a node at pos with the given destination. Each tetrahedron of the edge is split
+         * in two with the same label. Returns the new node.
+         */
+        NodeKey split(const TetMeshEdge& eid, const vec3& pos, const vec3& destination)
+        {
+            SimplexSet<TetrahedronKey> tids = get_tets(eid);
+            NodeKey new_nid = insert_node(pos, destination);
+            std::vector<std::array<NodeKey, 4>> new_tets;
+            std::vector<int> labels;
+            for (auto t : tids)
+            {
+                for (const NodeKey& n : eid.nids)
+                {
+                    new_tets.push_back(replaced(t, n, new_nid));
+                    labels.push_back(get_label(t));
+                }
+            }
+            retriangulate(tids, new_tets, labels);
+            return new_nid;
+        }
+
+        /**
+         * Collapses the edge eid. The node nid must be a node of eid. It survives at (1.-weight)*get_pos(nid) +
+         * weight*get_pos(nid_remove), where nid_remove is the other node, which is removed.
+         */
+        void collapse(const TetMeshEdge& eid, const NodeKey& nid, real weight = 0.5)
+        {
+            NodeKey nid_remove = eid.nids[0] == nid ? eid.nids[1] : eid.nids[0];
+            set_pos(nid, (1.-weight) * get_pos(nid) + weight * get_pos(nid_remove));
+            set_destination(nid, (1.-weight) * get_destination(nid) + weight * get_destination(nid_remove));
+
+            SimplexSet<TetrahedronKey> tids = get_tets(nid_remove);
+            std::vector<std::array<NodeKey, 4>> new_tets;
+            std::vector<int> labels;
+            for (auto t : tids)
+            {
+                if(index(t, nid) < 0)
+                {
+                    new_tets.push_back(replaced(t, nid_remove, nid));
+                    labels.push_back(get_label(t));
+                }
+            }
+            retriangulate(tids, new_tets, labels);
+            remove_node(nid_remove);
+        }
+
+        /**
+         * Replaces the three tetrahedra of the edge eid by two tetrahedra sharing the face spanned by the other nodes. Returns
+         * the new face.
+         */
+        TetMeshFace flip_32(const TetMeshEdge& eid)
+        {
+            std::vector<NodeKey> ring;
+            bool closed = edge_ring(eid, ring);
+#ifdef DEBUG
+            assert(closed && ring.size() == 3);
+#endif
+            (void)closed;
+            flip(eid, ring, {{0, 1, 2}});
+            return TetMeshFace(ring[0], ring[1], ring[2]);
+        }
+
+        /**
+         * Replaces the two tetrahedra of the face fid by three tetrahedra sharing the edge between the nodes opposite fid.
+         * Returns the new edge.
+         */
+        TetMeshEdge flip_23(const TetMeshFace& fid)
+        {
+            SimplexSet<TetrahedronKey> tids = get_tets(fid);
+#ifdef DEBUG
+            assert(tids.size() == 2);
+            assert(get_label(tids[0]) == get_label(tids[1]));
+#endif
+            NodeKey apex0 = m_tets[tids[0]].nodes[opposite(tids[0], fid)];
+            NodeKey apex1 = m_tets[tids[1]].nodes[opposite(tids[1], fid)];
+
+            // The nodes of fid in the order which makes (ring[i], ring[i+1], ring[i+2], apex0) positive.
+            std::array<NodeKey, 4> nids = positive_order(tids[0], apex0, fid.nids[0]);
+            std::array<NodeKey, 3> ring = {{nids[1], nids[3], nids[2]}};
+
+            std::vector<std::array<NodeKey, 4>> new_tets;
+            for (int i = 0; i < 3; i++)
+            {
+                new_tets.push_back({{apex0, apex1, ring[(i+1)%3], ring[i]}});
+            }
+            retriangulate(tids, new_tets, std::vector<int>(3, get_label(tids[0])));
+            return TetMeshEdge(apex0, apex1);
+        }
+
+        /**
+         * Replaces the tetrahedra of the edge eid by tetrahedra sharing the edge between the nodes of fid1 and fid2 which
+         * are not in eid. The edge must have four tetrahedra (4-4 flip), or two tetrahedra on the boundary (2-2 flip).
+         */
+        void flip(const TetMeshEdge& eid, const TetMeshFace& fid1, const TetMeshFace& fid2)
+        {
+            std::vector<NodeKey> ring;
+            bool closed = edge_ring(eid, ring);
+            int i = static_cast<int>(std::find(ring.begin(), ring.end(), third(fid1, eid)) - ring.begin());
+            int j = static_cast<int>(std::find(ring.begin(), ring.end(), third(fid2, eid)) - ring.begin());
+            int m = static_cast<int>(ring.size());
+#ifdef DEBUG
+            assert(i < m && j < m);
+            assert((closed && m == 4 && (i - j + 4)%4 == 2) || (!closed && m == 3 && i + j == 2 && i != j));
+#endif
+            (void)j;
+            if(closed)
+            {
+                flip(eid, ring, {{i, (i+1)%m, (i+2)%m}, {(i+2)%m, (i+3)%m, i}});
+            }
+            else {
+                flip(eid, ring, {{0, 1, 2}});
+            }
+        }
+
+        void flip_22(const TetMeshFace& fid1, const TetMeshFace& fid2)
+        {
+            flip(shared_edge(fid1, fid2), fid1, fid2);
+        }
+
+        void flip_44(const TetMeshFace& fid1, const TetMeshFace& fid2)
+        {
+            flip(shared_edge(fid1, fid2), fid1, fid2);
+        }
+
+        /**
+         * Checks that the neighbours are symmetric, that the seeds are incident to their nodes and that no tetrahedron is
+         * inverted.
+         */
+        void validity_check() const
+        {
+            size_t no_tets = 0, no_nodes = 0;
+            for (size_t i = 0; i < m_tets.size(); i++)
+            {
+                TetrahedronKey tid(i);
+                if(!exists(tid))
+                {
+                    continue;
+                }
+                no_tets++;
+                const tet& t = m_tets[tid];
+                for (int j = 0; j < 4; j++)
+                {
+                    assert(exists(t.nodes[j]));
+                    TetrahedronKey n = t.neighbours[j];
+                    if(n.is_valid())
+                    {
+                        assert(exists(n));
+                        assert(opposite(n, face(tid, j)) >= 0);
+                        assert(m_tets[n].neighbours[opposite(n, face(tid, j))] == tid);
+                    }
+                }
+                assert(Util::signed_volume<real>(get_pos(t.nodes[0]), get_pos(t.nodes[1]), get_pos(t.nodes[2]), get_pos(t.nodes[3])) > 0.);
+            }
+            for (size_t i = 0; i < m_nodes.size(); i++)
+            {
+                NodeKey nid(i);
+                if(exists(nid))
+                {
+                    no_nodes++;
+                    assert(exists(m_nodes[nid].seed));
+                    assert(index(m_nodes[nid].seed, nid) >= 0);
+                }
+            }
+            assert(no_tets == m_no_tets);
+            assert(no_nodes == m_no_nodes);
+            (void)no_tets;
+            (void)no_nodes;
+        }
+
+    private:
+
+        NodeKey insert_node(const vec3& pos, const vec3& destination)
+        {
+            NodeKey nid;
+            if(m_free_nodes.empty())
+            {
+                nid = NodeKey(m_nodes.size());
+                m_nodes.push_back(node());
+            }
+            else {
+                nid = m_free_nodes.back();
+                m_free_nodes.pop_back();
+            }
+            m_nodes[nid].pos = pos;
+            m_nodes[nid].destination = destination;
+            m_nodes[nid].seed = TetrahedronKey();
+            m_no_nodes++;
+            return nid;
+        }
+
+        void remove_node(const NodeKey& nid)
+        {
+            m_nodes[nid].seed = TetrahedronKey();
+            m_free_nodes.push_back(nid);
+            m_no_nodes--;
+        }
+
+        /**
+         * Inserts a tetrahedron without neighbours and makes it the seed of its nodes.
+         */
+        TetrahedronKey insert_tet(const std::array<NodeKey, 4>& nids, int label)
+        {
+            TetrahedronKey tid;
+            if(m_free_tets.empty())
+            {
+                tid = TetrahedronKey(m_tets.size());
+                m_tets.push_back(tet());
+            }
+            else {
+                tid = m_free_tets.back();
+                m_free_tets.pop_back();
+            }
+            tet& t = m_tets[tid];
+            for (int i = 0; i < 4; i++)
+            {
+                t.nodes[i] = nids[i];
+                t.neighbours[i] = TetrahedronKey();
+                m_nodes[nids[i]].seed = tid;
+            }
+            t.label = label;
+            m_no_tets++;
+            return tid;
+        }
+
+        void remove_tet(const TetrahedronKey& tid)
+        {
+            m_tets[tid].nodes[0] = NodeKey();
+            m_free_tets.push_back(tid);
+            m_no_tets--;
+        }
+
+        /**
+         * Returns the index of the node nid in the tetrahedron tid, or -1 if nid is not a node of tid.
+         */
+        int index(const TetrahedronKey& tid, const NodeKey& nid) const
+        {
+            const tet& t = m_tets[tid];
+            for (int i = 0; i < 4; i++)
+            {
+                if(t.nodes[i] == nid)
+                {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        /**
+         * Returns the index of the node of the tetrahedron tid which is not in the face fid, or -1 if fid is not a face of tid.
+         */
+        int opposite(const TetrahedronKey& tid, const TetMeshFace& fid) const
+        {
+            int i = -1, no_shared = 0;
+            for (int j = 0; j < 4; j++)
+            {
+                if(fid.contains(m_tets[tid].nodes[j]))
+                {
+                    no_shared++;
+                }
+                else {
+                    i = j;
+                }
+            }
+            return no_shared == 3 ? i : -1;
+        }
+
+        /**
+         * Returns the face of the tetrahedron tid opposite its i'th node.
+         */
+        TetMeshFace face(const TetrahedronKey& tid, int i) const
+        {
+            const tet& t = m_tets[tid];
+            return TetMeshFace(t.nodes[(i+1)%4], t.nodes[(i+2)%4], t.nodes[(i+3)%4]);
+        }
+
+        static NodeKey third(const TetMeshFace& fid, const TetMeshEdge& eid)
+        {
+            for (auto n : fid.nids)
+            {
+                if(n != eid.nids[0] && n != eid.nids[1])
+                {
+                    return n;
+                }
+            }
+            return NodeKey();
+        }
+
+        static TetMeshEdge shared_edge(const TetMeshFace& fid1, const TetMeshFace& fid2)
+        {
+            std::vector<NodeKey> nids;
+            for (auto n : fid1.nids)
+            {
+                if(fid2.contains(n))
+                {
+                    nids.push_back(n);
+                }
+            }
+            assert(nids.size() == 2);
+            return TetMeshEdge(nids[0], nids[1]);
+        }
+
+        /**
+         * Returns the nodes of the tetrahedron tid with the node from replaced by to.
+         */
+        std::array<NodeKey, 4> replaced(const TetrahedronKey& tid, const NodeKey& from, const NodeKey& to) const
+        {
+            const tet& t = m_tets[tid];
+            std::array<NodeKey, 4> nids = {{t.nodes[0], t.nodes[1], t.nodes[2], t.nodes[3]}};
+            nids[index(tid, from)] = to;
+            return nids;
+        }
+
+        /**
+         * Returns the nodes of the tetrahedron tid in positive order starting with the nodes a and b.
+         */
+        std::array<NodeKey, 4> positive_order(const TetrahedronKey& tid, const NodeKey& a, const NodeKey& b) const
+        {
+            int p[4] = {index(tid, a), index(tid, b), 0, 0};
+            int k = 2;
+            for (int i = 0; i < 4; i++)
+            {
+                if(i != p[0] && i != p[1])
+                {
+                    p[k++] = i;
+                }
+            }
+            int no_inversions = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                for (int j = i+1; j < 4; j++)
+                {
+                    no_inversions += p[i] > p[j] ? 1 : 0;
+                }
+            }
+            if(no_inversions%2 == 1)
+            {
+                std::swap(p[2], p[3]);
+            }
+            const tet& t = m_tets[tid];
+            return {{t.nodes[p[0]], t.nodes[p[1]], t.nodes[p[2]], t.nodes[p[3]]}};
+        }
+
+        /**
+         * Finds the nodes around the edge eid, ordered such that (u, v, ring[i+1], ring[i]) is a positive tetrahedron of the
+         * edge for each i, where u and v are the nodes of eid. Returns whether the ring is closed. An open ring starts and
+         * ends on the boundary and has one more node than the edge has tetrahedra.
+         */
+        bool edge_ring(const TetMeshEdge& eid, std::vector<NodeKey>& ring) const
+        {
+            const NodeKey& u = eid.nids[0];
+            const NodeKey& v = eid.nids[1];
+            TetrahedronKey start = get_tets(eid).front();
+
+            // Walks backwards to the boundary, if there is one.
+            bool closed = false;
+            TetrahedronKey t = start;
+            while (true)
+            {
+                std::array<NodeKey, 4> nids = positive_order(t, u, v);
+                TetrahedronKey prev = m_tets[t].neighbours[index(t, nids[2])];
+                if(!prev.is_valid())
+                {
+                    break;
+                }
+                if(prev == start)
+                {
+                    closed = true;
+                    break;
+                }
+                t = prev;
+            }
+
+            start = t;
+            ring.clear();
+            std::array<NodeKey, 4> nids = positive_order(start, u, v);
+            ring.push_back(nids[3]);
+            ring.push_back(nids[2]);
+            t = m_tets[start].neighbours[index(start, nids[3])];
+            while (t.is_valid() && t != start)
+            {
+                nids = positive_order(t, u, v);
+                assert(nids[3] == ring.back());
+                ring.push_back(nids[2]);
+                t = m_tets[t].neighbours[index(t, nids[3])];
+            }
+            if(closed)
+            {
+                ring.pop_back();
+            }
+            return closed;
+        }
+
+        /**
+         * Replaces the tetrahedra of the edge eid, whose nodes are ring as returned by edge_ring(), by the tetrahedra
+         * spanned by the given triangles of ring indices and each node of eid. The triangles must follow the order of ring.
+         */
+        void flip(const TetMeshEdge& eid, const std::vector<NodeKey>& ring, const std::vector<std::array<int, 3>>& triangles)
+        {
+            SimplexSet<TetrahedronKey> tids = get_tets(eid);
+            int label = get_label(tids[0]);
+#ifdef DEBUG
+            for (auto t : tids)
+            {
+                assert(get_label(t) == label);
+            }
+#endif
+            std::vector<std::array<NodeKey, 4>> new_tets;
+            for (auto& tri : triangles)
+            {
+                new_tets.push_back({{ring[tri[0]], ring[tri[1]], ring[tri[2]], eid.nids[0]}});
+                new_tets.push_back({{ring[tri[1]], ring[tri[0]], ring[tri[2]], eid.nids[1]}});
+            }
+            retriangulate(tids, new_tets, std::vector<int>(new_tets.size(), label));
+        }
+
+        /**
+         * Replaces the tetrahedra tids by tetrahedra with the nodes new_tets and the labels labels. The new tetrahedra must
+         * fill the same region, such that each face between tids and the rest of the mesh is a face of exactly one new
+         * tetrahedron. Faces on the boundary of the domain may change, as in a 2-2 flip. The neighbours and the seeds are
+         * updated. Returns the new tetrahedra.
+         */
+        std::vector<TetrahedronKey> retriangulate(const SimplexSet<TetrahedronKey>& tids, const std::vector<std::array<NodeKey, 4>>& new_tets, const std::vector<int>& labels)
+        {
+            typedef std::pair<TetMeshFace, std::pair<TetrahedronKey, int>> face_side;
+            auto less = [](const face_side& a, const face_side& b) { return a.first < b.first; };
+
+            // The faces on the boundary of tids with the tetrahedron outside, which may be invalid.
+            std::vector<face_side> outer;
+            std::vector<NodeKey> nids;
+            for (auto t : tids)
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    TetrahedronKey n = m_tets[t].neighbours[i];
+                    if(!n.is_valid() || !tids.contains(n))
+                    {
+                        outer.push_back({face(t, i), {n, i}});
+                    }
+                    nids.push_back(m_tets[t].nodes[i]);
+                }
+            }
+            std::sort(outer.begin(), outer.end(), less);
+            for (auto t : tids)
+            {
+                remove_tet(t);
+            }
+
+            std::vector<TetrahedronKey> result;
+            std::vector<face_side> inner;
+            for (size_t i = 0; i < new_tets.size(); i++)
+            {
+                TetrahedronKey tid = insert_tet(new_tets[i], labels[i]);
+                result.push_back(tid);
+                for (int j = 0; j < 4; j++)
+                {
+                    inner.push_back({face(tid, j), {tid, j}});
+                }
+            }
+            std::sort(inner.begin(), inner.end(), less);
+#ifdef DEBUG
+            size_t no_matched = 0;
+#endif
+
+            for (size_t i = 0; i < inner.size(); i++)
+            {
+                const face_side& fs = inner[i];
+                if(i + 1 < inner.size() && inner[i+1].first == fs.first)
+                {
+                    m_tets[fs.second.first].neighbours[fs.second.second] = inner[i+1].second.first;
+                    m_tets[inner[i+1].second.first].neighbours[inner[i+1].second.second] = fs.second.first;
+                    i++;
+                    continue;
+                }
+                auto it = std::lower_bound(outer.begin(), outer.end(), fs, less);
+                if(it != outer.end() && it->first == fs.first && it->second.first.is_valid())
+                {
+                    TetrahedronKey n = it->second.first;
+                    m_tets[fs.second.first].neighbours[fs.second.second] = n;
+                    m_tets[n].neighbours[opposite(n, fs.first)] = fs.second.first;
+#ifdef DEBUG
+                    no_matched++;
+#endif
+                }
+            }
+#ifdef DEBUG
+            assert(no_matched == static_cast<size_t>(std::count_if(outer.begin(), outer.end(), [](const face_side& fs) { return fs.second.first.is_valid(); })));
+#endif
+
+            // The nodes of tids which are not in a new tetrahedron get a seed outside tids.
+            for (auto n : nids)
+            {
+                TetrahedronKey seed = m_nodes[n].seed;
+                if(exists(seed) && index(seed, n) >= 0)
+                {
+                    continue;
+                }
+                m_nodes[n].seed = TetrahedronKey();
+                for (auto& fs : outer)
+                {
+                    if(fs.second.first.is_valid() && fs.first.contains(n))
+                    {
+                        m_nodes[n].seed = fs.second.first;
+                        break;
+                    }
+                }
+            }
+            return result;
+        }
+    };
+}
@@ -0,0 +1,185 @@
+//
+//  Deformabel Simplicial Complex (DSC) method
+//  Copyright (C) 2013  Technical University of Denmark
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  See licence.txt for a copy of the GNU General Public License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace is_mesh
+{
+    /**
+     * A fixed pool of worker threads. The calling thread always takes part in the work, so a pool of size one runs everything
+     * serially on the caller without any synchronization. Calls to the pool made from inside a running job are executed serially.
+     */
+    class ThreadPool
+    {
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable work_ready;
+        std::condition_variable work_done;
+
+        std::function<void(unsigned int, unsigned int)> job;
+        unsigned int generation = 0;
+        unsigned int no_busy = 0;
+        bool running = false;
+        bool stop = false;
+
+        void worker(unsigned int thread)
+        {
+            unsigned int seen = 0;
+            while(true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    work_ready.wait(lock, [&]{ return stop || generation != seen; });
+                    if(stop)
+                    {
+                        return;
+                    }
+                    seen = generation;
+                }
+                job(thread, size());
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    no_busy--;
+                    if(no_busy == 0)
+                    {
+                        work_done.notify_all();
+                    }
+                }
+            }
+        }
+
+        /**
+         * Runs f(thread, no_threads) once on each of the no_threads participating threads (the calling thread gets index 0)
+         * and waits for all of them to finish. If the pool is already running a job, f(0, 1) is called on the calling thread.
+         */
+        void run(const std::function<void(unsigned int, unsigned int)>& f)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if(running || workers.empty())
+                {
+                    lock.unlock();
+                    f(0, 1);
+                    return;
+                }
+                running = true;
+                job = f;
+                no_busy = static_cast<unsigned int>(workers.size());
+                generation++;
+            }
+            work_ready.notify_all();
+            f(0, size());
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_done.wait(lock, [&]{ return no_busy == 0; });
+                running = false;
+            }
+        }
+
+    public:
+        /**
+         * Creates a pool with no_threads threads in total, including the calling thread.
+         */
+        ThreadPool(unsigned int no_threads = std::thread::hardware_concurrency())
+        {
+            for (unsigned int i = 1; i < no_threads; i++)
+            {
+                workers.push_back(std::thread(&ThreadPool::worker, this, i));
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                stop = true;
+            }
+            work_ready.notify_all();
+            for (auto& w : workers)
+            {
+                w.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * Returns the number of threads in the pool, including the calling thread.
+         */
+        unsigned int size() const
+        {
+            return static_cast<unsigned int>(workers.size()) + 1;
+        }
+
+        /**
+         * Calls f(i) for every i in [begin, end). The indices are handed out dynamically in chunks of grain indices.
+         */
+        void parallel_for(size_t begin, size_t end, const std::function<void(size_t)>& f, size_t grain = 64)
+        {
+            if(end <= begin)
+            {
+                return;
+            }
+            if(size() == 1 || end - begin <= grain)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    f(i);
+                }
+                return;
+            }
+            std::atomic<size_t> next(begin);
+            run([&](unsigned int, unsigned int)
+            {
+                size_t b;
+                while((b = next.fetch_add(grain)) < end)
+                {
+                    size_t e = std::min(b + grain, end);
+                    for (size_t i = b; i < e; i++)
+                    {
+                        f(i);
+                    }
+                }
+            });
+        }
+
+        /**
+         * Splits [0, n) into size() contiguous blocks and calls f(block, begin, end) once for each block. The blocks are
+         * ordered, so results written per block can be combined by a prefix sum over the block index.
+         */
+        void parallel_blocks(size_t n, const std::function<void(unsigned int, size_t, size_t)>& f)
+        {
+            const unsigned int no_blocks = size();
+            run([&](unsigned int thread, unsigned int no_threads)
+            {
+                for (unsigned int b = thread; b < no_blocks; b += no_threads)
+                {
+                    f(b, (n*b)/no_blocks, (n*(b+1))/no_blocks);
+                }
+            });
+        }
+    };
+}
@@ -16,10 +16,15 @@
 
 #pragma once
 
+#include <chrono>
+
 #include "is_mesh.h"
 #include "attributes.h"
 #include "geometry.h"
 #include "mesh_io.h"
+#include "quality_queue.h"
+#include "klincsek_table.h"
+#include "star_optimizer.h"
 
 struct parameters {
     
@@ -50,6 +55,37 @@ struct parameters {
 
 namespace DSC {
     
+    /**
+     * Specifies how smooth() visits the nodes:
+     * SERIAL: One by one in kernel order, each node seeing the moves of the nodes before it.
+     * COLORED: In color classes of nodes which share no tetrahedron. The new positions of a class are computed in parallel
+     * and applied together, before the next class is visited.
+     * JACOBI: All nodes are evaluated in parallel on the current positions. The improving moves which do not conflict with
+     * a better improving move in the same star are applied, and the nodes which lost a conflict are evaluated again.
+     */
+    enum SmoothingMode {SERIAL, COLORED, JACOBI};
+    
+    /**
+     * The passes of the mesh improvement which fix_complex() runs in the order given by set_fix_pipeline().
+     */
+    enum FixPass {SMOOTHING, EDGE_REMOVAL, FACE_REMOVAL, DEGENERATE_TET_REMOVAL, DEGENERATE_FACE_REMOVAL, DEGENERATE_EDGE_REMOVAL};
+    
+    /**
+     * The record of a pass of fix_complex(). The yield of a run is the number of successful edits (moves, flips, collapses
+     * and splits) per second.
+     */
+    struct pass_statistics {
+        int calls = 0;
+        int runs = 0;
+        int changes = 0;
+        real time = 0.;
+        real last_yield = INFINITY;
+        
+        // The number of calls of fix_complex() to skip the pass after its last run, and the number left to skip.
+        int interval = 0;
+        int skip = 0;
+    };
+    
     template <typename node_att = is_mesh::NodeAttributes, typename edge_att = is_mesh::EdgeAttributes, typename face_att = is_mesh::FaceAttributes, typename tet_att = is_mesh::TetAttributes>
     class DeformableSimplicialComplex : public is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>
     {
@@ -73,6 +109,27 @@ namespace DSC {
         
         parameters pars;
         
+        // The tetrahedra with quality lower than MIN_TET_QUALITY, worst first. Shared by the passes of fix_complex().
+        is_mesh::QualityQueue<tet_key> low_quality_tets;
+        real improvement_time_budget = INFINITY;
+        
+        // The number of edge rings around the edited nodes that the mesh improvement is restricted to, or -1 for the whole
+        // complex. The seeds are the nodes moved or edited during the current call to deform().
+        int band_rings = -1;
+        std::vector<node_key> band_seeds;
+        std::vector<node_key> band;
+        
+        // Whether deform() moves the nodes in parallel batches, see move_vertices_in_batches().
+        bool parallel_motion = false;
+        SmoothingMode smoothing_mode = SERIAL;
+        bool smoothing_optimization = false;
+        
+        // The passes run by fix_complex(), their statistics indexed by FixPass, and the throttling of low yield passes.
+        std::vector<FixPass> fix_pipeline = {SMOOTHING, EDGE_REMOVAL, FACE_REMOVAL, DEGENERATE_TET_REMOVAL, DEGENERATE_FACE_REMOVAL, DEGENERATE_EDGE_REMOVAL};
+        std::vector<pass_statistics> pass_stats = std::vector<pass_statistics>(6);
+        int max_pass_interval = 0;
+        real min_pass_yield = 0.;
+        
         //////////////////////////
         // INITIALIZE FUNCTIONS //
         //////////////////////////
@@ -87,6 +144,33 @@ namespace DSC {
             set_avg_edge_length();
         }
         
+        /**
+         * Creates a copy-on-write snapshot of the complex, see the copy constructor of ISMesh. The design domain and the
+         * parameters are copied, so the snapshot can also be deformed independently of dsc.
+         */
+        DeformableSimplicialComplex(const DeformableSimplicialComplex& dsc) :
+            is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>(dsc), design_domain(dsc.design_domain), AVG_LENGTH(dsc.AVG_LENGTH), AVG_AREA(dsc.AVG_AREA), AVG_VOLUME(dsc.AVG_VOLUME), pars(dsc.pars), improvement_time_budget(dsc.improvement_time_budget), band_rings(dsc.band_rings), band_seeds(dsc.band_seeds), band(dsc.band), parallel_motion(dsc.parallel_motion), smoothing_mode(dsc.smoothing_mode), smoothing_optimization(dsc.smoothing_optimization), fix_pipeline(dsc.fix_pipeline), pass_stats(dsc.pass_stats), max_pass_interval(dsc.max_pass_interval), min_pass_yield(dsc.min_pass_yield)
+        {
+            
+        }
+        
+        /**
+         * Returns a copy of the complex for speculative runs, e.g. trying two velocity functions from the same state. The
+         * copy has the same keys, flags, positions, destinations, parameters, design domain and number of threads. The
+         * pages of the mesh are shared copy-on-write, so cloning only copies page pointers. If detach is true, all memory is
+         * copied right away instead of during the first edits of either complex.
+         */
+        DeformableSimplicialComplex* clone(bool detach = false)
+        {
+            DeformableSimplicialComplex* dsc = new DeformableSimplicialComplex(*this);
+            dsc->set_no_threads(this->get_thread_pool().size());
+            if(detach)
+            {
+                dsc->detach();
+            }
+            return dsc;
+        }
+        
         ~DeformableSimplicialComplex()
         {
             
@@ -113,11 +197,15 @@ namespace DSC {
 
         using is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>::get_edge;
         using is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>::get_face;
+        using is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>::get_interface_surface;
+        using is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>::get_interface_faces;
 
         using is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>::validity_check;
+        using is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>::local_validity_check;
 
     protected:
         using is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>::set_label;
+        using is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>::set_labels;
 
     private:
 
@@ -153,6 +241,90 @@ namespace DSC {
             pars = pars_;
         }
         
+        /**
+         * Sets the time in seconds each mesh improvement pass may spend on the low quality tetrahedra, see improve_worst_first().
+         * When the budget is spent, the remaining tetrahedra are left for the next time step. The default is no limit.
+         */
+        void set_improvement_time_budget(real seconds)
+        {
+            improvement_time_budget = seconds;
+        }
+        
+        /**
+         * Restricts the mesh improvement in deform() (smoothing, edge and face removal, degeneracy removal, thickening and
+         * thinning) to a narrow band: the nodes moved or edited during the current time step, expanded by the given number
+         * of edge rings, and their stars. The rest of the complex is not visited. A negative number of rings improves the
+         * whole complex, which is the default.
+         */
+        void set_narrow_band(int rings)
+        {
+            band_rings = rings;
+            band_seeds.clear();
+            band.clear();
+            this->track_edited_nodes(rings >= 0);
+            this->take_edited_nodes();
+        }
+        
+        /**
+         * Sets whether deform() moves the nodes in parallel. The nodes are then moved in batches in which no two nodes share
+         * a tetrahedron, with the positions of a batch computed concurrently. The nodes are moved in a different order than
+         * the serial motion, so the result differs slightly, but it does not depend on the number of threads. The default
+         * is the serial motion.
+         */
+        void set_parallel_motion(bool parallel)
+        {
+            parallel_motion = parallel;
+        }
+        
+        /**
+         * Sets how the smoothing in fix_complex() visits the nodes, see SmoothingMode. The parallel modes move the nodes in
+         * a different order than the serial smoothing, so the result differs slightly, but it does not depend on the number
+         * of threads. The default is SERIAL.
+         */
+        void set_smoothing_mode(SmoothingMode mode)
+        {
+            smoothing_mode = mode;
+        }
+        
+        /**
+         * Sets whether the smoothing optimizes the position of a node when the Laplacian smoothing is rejected or leaves a
+         * tetrahedron in the star with quality below MIN_TET_QUALITY, see optimize_position(). The default is false.
+         */
+        void set_smoothing_optimization(bool optimize)
+        {
+            smoothing_optimization = optimize;
+        }
+        
+        /**
+         * Sets the passes which fix_complex() runs, in order. A pass may be left out or appear more than once. The default
+         * is smoothing, edge removal, face removal and the removal of degenerate tetrahedra, faces and edges.
+         */
+        void set_fix_pipeline(const std::vector<FixPass>& passes)
+        {
+            fix_pipeline = passes;
+        }
+        
+        const std::vector<FixPass>& get_fix_pipeline() const
+        {
+            return fix_pipeline;
+        }
+        
+        /**
+         * Throttles the passes of fix_complex() with a low yield. A pass whose last run made at most min_yield successful
+         * edits per second is skipped in the next 1, 2, 4, ... calls, up to max_interval calls, until a run yields more.
+         * The default max_interval of 0 runs every pass in every call.
+         */
+        void set_pass_throttling(int max_interval, real min_yield = 0.)
+        {
+            max_pass_interval = max_interval;
+            min_pass_yield = min_yield;
+        }
+        
+        const pass_statistics& get_pass_statistics(FixPass pass) const
+        {
+            return pass_stats[pass];
+        }
+        
         void set_design_domain(is_mesh::Geometry *geometry)
         {
             design_domain.add_geometry(geometry);
@@ -160,13 +332,7 @@ namespace DSC {
         
         virtual void set_labels(const is_mesh::Geometry& geometry, int label)
         {
-            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++) {
-                is_mesh::SimplexSet<is_mesh::NodeKey> nids = get_nodes(tit.key());
-                if(geometry.is_inside(Util::barycenter(get(nids[0]).get_pos(), get(nids[1]).get_pos(), get(nids[2]).get_pos(), get(nids[3]).get_pos())))
-                {
-                    set_label(tit.key(), label);
-                }
-            }
+            this->set_labels_where([&](const vec3& p) { return geometry.is_inside(p); }, label);
         }
         
     private:
@@ -290,7 +456,7 @@ namespace DSC {
          */
         void set_pos(const node_key& nid, const vec3& p)
         {
-            get(nid).set_pos(p);
+            is_mesh::ISMesh<node_att, edge_att, face_att, tet_att>::set_pos(nid, p);
             if(!is_movable(nid))
             {
                 get(nid).set_destination(p);
@@ -360,56 +526,233 @@ namespace DSC {
         ////////////////////////
     private:
         
-        //////////////////////////////
-        // TOPOLOGICAL EDGE REMOVAL //
-        //////////////////////////////
+        /**
+         * Adds the nodes edited since the last update to the seeds of the narrow band and recomputes the band.
+         */
+        void update_band()
+        {
+            if(band_rings < 0)
+            {
+                return;
+            }
+            std::vector<node_key> edited = this->take_edited_nodes();
+            band_seeds.insert(band_seeds.end(), edited.begin(), edited.end());
+            band_seeds = this->get_k_ring(band_seeds, 0);
+            band = this->get_k_ring(band_seeds, static_cast<unsigned int>(band_rings));
+        }
         
         /**
-         * Build a table K for the dynamic programming method by Klincsek (see Shewchuk "Two Discrete Optimization Algorithms
-         * for the Topological Improvement of Tetrahedral Meshes" article for details).
+         * Returns the nodes the mesh improvement is restricted to, which is the narrow band or all nodes.
          */
-        real build_table(const edge_key& e, const is_mesh::SimplexSet<node_key>& polygon, std::vector<std::vector<int>>& K)
+        std::vector<node_key> active_nodes()
         {
-            is_mesh::SimplexSet<node_key> nids = get_nodes(e);
-            
-            const int m = (int) polygon.size();
-            
-            auto Q = std::vector<std::vector<real>>(m-1, std::vector<real>(m, 0.));
-            K = std::vector<std::vector<int>>(m-1, std::vector<int>(m, 0) );
-            
-            for(int i = 0; i < m-1; i++)
+            std::vector<node_key> nids;
+            if(band_rings >= 0)
             {
-                Q[i][i+1] = INFINITY;
+                for (auto n : band)
+                {
+                    if(exists(n))
+                    {
+                        nids.push_back(n);
+                    }
+                }
             }
-            
-            for (int i = m-3; i >= 0; i--)
+            else {
+                for (auto nit = nodes_begin(); nit != nodes_end(); nit++)
+                {
+                    nids.push_back(nit.key());
+                }
+            }
+            return nids;
+        }
+        
+        /**
+         * Returns the edges the mesh improvement is restricted to, which is the edges incident to the narrow band or all edges.
+         */
+        std::vector<edge_key> active_edges()
+        {
+            std::vector<edge_key> eids;
+            if(band_rings >= 0)
+            {
+                std::vector<face_key> fids;
+                std::vector<tet_key> tids;
+                this->get_stars(active_nodes(), eids, fids, tids);
+            }
+            else {
+                for (auto eit = edges_begin(); eit != edges_end(); eit++)
+                {
+                    eids.push_back(eit.key());
+                }
+            }
+            return eids;
+        }
+        
+        /**
+         * Returns the faces the mesh improvement is restricted to, which is the faces incident to the narrow band or all faces.
+         */
+        std::vector<face_key> active_faces()
+        {
+            std::vector<face_key> fids;
+            if(band_rings >= 0)
             {
-                for (int j = i+2; j < m; j++)
+                std::vector<edge_key> eids;
+                std::vector<tet_key> tids;
+                this->get_stars(active_nodes(), eids, fids, tids);
+            }
+            else {
+                for (auto fit = faces_begin(); fit != faces_end(); fit++)
                 {
-                    for (int k = i+1; k < j; k++)
+                    fids.push_back(fit.key());
+                }
+            }
+            return fids;
+        }
+        
+        /**
+         * Returns the tetrahedra the mesh improvement is restricted to, which is the tetrahedra incident to the narrow band
+         * or all tetrahedra.
+         */
+        std::vector<tet_key> active_tets()
+        {
+            std::vector<tet_key> tids;
+            if(band_rings >= 0)
+            {
+                std::vector<edge_key> eids;
+                std::vector<face_key> fids;
+                this->get_stars(active_nodes(), eids, fids, tids);
+            }
+            else {
+                for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+                {
+                    tids.push_back(tit.key());
+                }
+            }
+            return tids;
+        }
+        
+        /**
+         * Fills the queue of low quality tetrahedra with the active tetrahedra of quality lower than MIN_TET_QUALITY. This is
+         * the only sweep over the tetrahedra in fix_complex(), the passes afterwards only visit the queue.
+         */
+        void queue_low_quality_tets()
+        {
+            low_quality_tets.clear();
+            for (auto t : active_tets())
+            {
+                real q = quality(t);
+                if (q < pars.MIN_TET_QUALITY)
+                {
+                    low_quality_tets.push(t, q);
+                }
+            }
+        }
+        
+        /**
+         * Pushes the tetrahedra incident to the nodes nids with quality lower than MIN_TET_QUALITY to the queue of low quality tetrahedra.
+         */
+        void queue_low_quality_tets(const std::vector<node_key>& nids)
+        {
+            for (auto n : nids)
+            {
+                if (exists(n))
+                {
+                    for (auto t : get_tets(n))
                     {
-                        real q2 = Util::quality<real>(get_pos(polygon[i]), get_pos(polygon[k]), get_pos(nids[0]), get_pos(polygon[j]));
-                        real q1 = Util::quality<real>(get_pos(polygon[k]), get_pos(polygon[i]), get_pos(nids[1]), get_pos(polygon[j]));
-                        real q = Util::min(q1, q2);
-                        if (k < j-1)
-                        {
-                            q = Util::min(q, Q[k][j]);
-                        }
-                        if (k > i+1)
-                        {
-                            q = Util::min(q, Q[i][k]);
-                        }
-                        
-                        if (k == i+1 || q > Q[i][j])
+                        real q = quality(t);
+                        if (q < pars.MIN_TET_QUALITY)
                         {
-                            Q[i][j] = q;
-                            K[i][j] = k;
+                            low_quality_tets.push(t, q);
                         }
                     }
                 }
             }
-            
-            return Q[0][m-1];
+        }
+        
+        /**
+         * Applies the operation op to the tetrahedra in the queue of low quality tetrahedra, worst first, until the lowest
+         * quality in the queue is at least threshold or the time budget is spent. op(t) returns whether it changed the complex
+         * around t. The low quality tetrahedra of the changed neighbourhoods and the tetrahedra for which op failed are pushed
+         * after the pass, such that the next pass handles the tetrahedra created by this one without a sweep over the complex.
+         * They are not handled in the same pass, since some operations (e.g. boundary flips) can undo each other. Entries
+         * of removed tetrahedra or with an outdated quality are skipped or re-queued when they are popped. Returns the number
+         * of successful operations and sets attempts to the number of tetrahedra op was applied to.
+         */
+        template<typename Op>
+        int improve_worst_first(real threshold, int& attempts, Op op)
+        {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<tet_key> failed;
+            std::vector<node_key> changed;
+            int i = 0;
+            attempts = 0;
+            while (!low_quality_tets.empty() && low_quality_tets.top_quality() < threshold)
+            {
+                if (std::chrono::duration<real>(std::chrono::steady_clock::now() - start).count() > improvement_time_budget)
+                {
+                    break;
+                }
+                real q_queued = low_quality_tets.top_quality();
+                tet_key t = low_quality_tets.pop();
+                if (!exists(t))
+                {
+                    continue;
+                }
+                real q = quality(t);
+                if (q != q_queued)
+                {
+                    if (q < pars.MIN_TET_QUALITY)
+                    {
+                        low_quality_tets.push(t, q);
+                    }
+                    continue;
+                }
+                
+                // Every tetrahedron created by an operation on t is incident to a node of t or of its neighbours.
+                is_mesh::SimplexSet<node_key> nids = get_nodes(get_tets(get_faces(t)));
+                attempts++;
+                if (op(t))
+                {
+                    i++;
+                    changed.insert(changed.end(), nids.begin(), nids.end());
+                }
+                else {
+                    failed.push_back(t);
+                }
+            }
+            for (auto t : failed)
+            {
+                if (exists(t))
+                {
+                    real q = quality(t);
+                    if (q < pars.MIN_TET_QUALITY)
+                    {
+                        low_quality_tets.push(t, q);
+                    }
+                }
+            }
+            std::sort(changed.begin(), changed.end());
+            changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+            queue_low_quality_tets(changed);
+            return i;
+        }
+        
+        //////////////////////////////
+        // TOPOLOGICAL EDGE REMOVAL //
+        //////////////////////////////
+        
+        /**
+         * Build a table K for the dynamic programming method by Klincsek (see Shewchuk "Two Discrete Optimization Algorithms
+         * for the Topological Improvement of Tetrahedral Meshes" article for details).
+         */
+        real build_table(const edge_key& e, const is_mesh::SimplexSet<node_key>& polygon, is_mesh::KlincsekTable& K)
+        {
+            const is_mesh::SimplexSet<node_key>& nids = get_nodes(e);
+            K.clear();
+            for (auto n : polygon)
+            {
+                K.push_back(get_pos(n));
+            }
+            return K.build(get_pos(nids[0]), get_pos(nids[1]));
         }
         
         
@@ -491,21 +834,21 @@ namespace DSC {
             return polygons;
         }
         
-        void flip_23_recursively(const is_mesh::SimplexSet<node_key>& polygon, const node_key& n1, const node_key& n2, std::vector<std::vector<int>>& K, int i, int j)
+        void flip_23_recursively(const is_mesh::SimplexSet<node_key>& polygon, const node_key& n1, const node_key& n2, const is_mesh::KlincsekTable& K, int i, int j)
         {
             if(j >= i+2)
             {
-                int k = K[i][j];
+                int k = K(i, j);
                 flip_23_recursively(polygon, n1, n2, K, i, k);
                 flip_23_recursively(polygon, n1, n2, K, k, j);
                 flip_23(get_face(n1, n2, polygon[k]));
             }
         }
         
-        void topological_edge_removal(const is_mesh::SimplexSet<node_key>& polygon, const node_key& n1, const node_key& n2, std::vector<std::vector<int>>& K)
+        void topological_edge_removal(const is_mesh::SimplexSet<node_key>& polygon, const node_key& n1, const node_key& n2, const is_mesh::KlincsekTable& K)
         {
             const int m = static_cast<int>(polygon.size());
-            int k = K[0][m-1];
+            int k = K(0, m-1);
             flip_23_recursively(polygon, n1, n2, K, 0, k);
             flip_23_recursively(polygon, n1, n2, K, k, m-1);
             flip_32(get_edge(n1, n2));
@@ -522,7 +865,8 @@ namespace DSC {
             assert(polygon.size() == 1 && polygon.front().size() > 2);
 #endif
             
-            std::vector<std::vector<int>> K;
+            // The table is reused between calls, so it does not allocate once it has grown to the largest polygon.
+            static thread_local is_mesh::KlincsekTable K;
             real q_new = build_table(eid, polygon.front(), K);
             
             if (q_new > min_quality(get_tets(eid)))
@@ -534,12 +878,12 @@ namespace DSC {
             return false;
         }
         
-        void topological_boundary_edge_removal(const is_mesh::SimplexSet<node_key>& polygon1, const is_mesh::SimplexSet<node_key>& polygon2, const edge_key& eid, std::vector<std::vector<int>>& K1, std::vector<std::vector<int>>& K2)
+        void topological_boundary_edge_removal(const is_mesh::SimplexSet<node_key>& polygon1, const is_mesh::SimplexSet<node_key>& polygon2, const edge_key& eid, const is_mesh::KlincsekTable& K1, const is_mesh::KlincsekTable& K2)
         {
             auto nids = get_nodes(eid);
             const int m1 = static_cast<int>(polygon1.size());
             const int m2 = static_cast<int>(polygon2.size());
-            int k = K1[0][m1-1];
+            int k = K1(0, m1-1);
             flip_23_recursively(polygon1, nids[0], nids[1], K1, 0, k);
             flip_23_recursively(polygon1, nids[0], nids[1], K1, k, m1-1);
             
@@ -557,7 +901,7 @@ namespace DSC {
                 }
             }
             else {
-                k = K2[0][m2-1];
+                k = K2(0, m2-1);
                 flip_23_recursively(polygon2, nids[0], nids[1], K2, 0, k);
                 flip_23_recursively(polygon2, nids[0], nids[1], K2, k, m2-1);
                 
@@ -581,7 +925,7 @@ namespace DSC {
                 return false;
             }
             
-            std::vector<std::vector<int>> K1, K2;
+            static thread_local is_mesh::KlincsekTable K1, K2;
             real q_new = build_table(eid, polygons[0], K1);
             
             if(polygons.size() == 2 && polygons[1].size() > 2)
@@ -605,93 +949,94 @@ namespace DSC {
          * Improve tetrahedra quality by the topological operation (re-connection) edge removal. It do so only for tetrahedra of quality lower than MIN_TET_QUALITY.
          * For details see "Two Discrete Optimization Algorithms for the Topological Improvement of Tetrahedral Meshes" by Shewchuk.
          */
-        void topological_edge_removal()
+        int topological_edge_removal()
         {
-            std::vector<tet_key> tets;
-            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            // Attempt to remove each edge of each low quality tetrahedron, worst first. Accept if it increases the minimum quality locally.
+            int j = 0, k = 0;
+            int i = improve_worst_first(pars.MIN_TET_QUALITY, j, [&](const tet_key& t)
             {
-                if (quality(tit.key()) < pars.MIN_TET_QUALITY)
+                if (!is_unsafe_editable(t))
                 {
-                    tets.push_back(tit.key());
+                    return false;
                 }
-            }
-            
-            // Attempt to remove each edge of each tetrahedron in tets. Accept if it increases the minimum quality locally.
-            int i = 0, j = 0, k = 0;
-            for (auto &t : tets)
-            {
-                if (is_unsafe_editable(t) && quality(t) < pars.MIN_TET_QUALITY)
+                for (auto e : get_edges(t))
                 {
-                    for (auto e : get_edges(t))
+                    if(is_safe_editable(e))
                     {
-                        if(is_safe_editable(e))
+                        if(topological_edge_removal(e))
                         {
-                            if(topological_edge_removal(e))
-                            {
-                                i++;
-                                break;
-                            }
+                            return true;
                         }
-                        else if(exists(e) && (get(e).is_interface() || get(e).is_boundary()) && is_flippable(e))
+                    }
+                    else if(exists(e) && (get(e).is_interface() || get(e).is_boundary()) && is_flippable(e))
+                    {
+                        if(topological_boundary_edge_removal(e))
                         {
-                            if(topological_boundary_edge_removal(e))
-                            {
-                                k++;
-                                break;
-                            }
+                            k++;
+                            return true;
                         }
                     }
-                    j++;
                 }
-            }
+                return false;
+            });
 #ifdef DEBUG
-            std::cout << "Topological edge removals: " << i + k << "/" << j << " (" << k << " at interface)" << std::endl;
+            std::cout << "Topological edge removals: " << i << "/" << j << " (" << k << " at interface)" << std::endl;
 #endif
             garbage_collect();
+            return i;
         }
         
         //////////////////////////////
         // TOPOLOGICAL FACE REMOVAL //
         //////////////////////////////
         
-        is_mesh::SimplexSet<edge_key> test_neighbour(const face_key& f, const node_key& a, const node_key& b, const node_key& u, const node_key& w, real& q_old, real& q_new)
+        /**
+         * Finds the best removal of the faces sandwiched between the apices a and b beyond the edge (u, w) of the face f by the
+         * dynamic programming method of multi-face removal (see Shewchuk "Two Discrete Optimization Algorithms for the
+         * Topological Improvement of Tetrahedral Meshes"). The face g beyond the edge is either kept, which creates the
+         * tetrahedron (a, b, w, u), or removed together with the best removals beyond its edges (u, v) and (v, w), whichever
+         * gives the larger minimum quality of the new tetrahedra. Returns this quality. The minimum quality of the removed
+         * tetrahedra is returned in q_old, and the edges to flip are appended to edges in the order they should be flipped.
+         * The faces in visited are never removed, which cuts the cycles of sandwiched faces around a node.
+         */
+        real multi_face_removal(const face_key& f, const node_key& a, const node_key& b, const node_key& u, const node_key& w,
+                                is_mesh::SimplexSet<face_key>& visited, real& q_old, std::vector<edge_key>& edges)
         {
-            edge_key e = get_edge(u,w);
+            real q_keep = Util::quality<real>(get_pos(a), get_pos(b), get_pos(w), get_pos(u));
+            q_old = INFINITY;
+            
+            edge_key e = get_edge(u, w);
+            if(!is_safe_editable(e))
+            {
+                return q_keep;
+            }
             is_mesh::SimplexSet<face_key> g_set = get_faces(e) - get_faces(get_tets(f));
-            real q = Util::quality<real>(get_pos(a), get_pos(b), get_pos(w), get_pos(u));
+            if(g_set.size() != 1 || visited.contains(g_set.front()))
+            {
+                return q_keep;
+            }
+            face_key g = g_set.front();
+            is_mesh::SimplexSet<node_key> apices = get_nodes(get_tets(g)) - get_nodes(g);
+            if(apices.size() != 2 || !apices.contains(a) || !apices.contains(b))
+            {
+                return q_keep;
+            }
+            visited += g;
+            node_key v = (get_nodes(g) - get_nodes(e)).front();
             
-            if(g_set.size() == 1 && is_safe_editable(e))
+            real q_uv_old, q_vw_old;
+            std::vector<edge_key> uv_edges, vw_edges;
+            real q_remove = Util::min(multi_face_removal(g, a, b, u, v, visited, q_uv_old, uv_edges),
+                                      multi_face_removal(g, a, b, v, w, visited, q_vw_old, vw_edges));
+            if(q_remove > q_keep)
             {
-                face_key g = g_set.front();
-                node_key v = (get_nodes(g) - get_nodes(e)).front();
-                real V_uv = Util::signed_volume<real>(get_pos(a), get_pos(b), get_pos(v), get_pos(u));
-                real V_vw = Util::signed_volume<real>(get_pos(a), get_pos(b), get_pos(w), get_pos(v));
-                real V_wu = Util::signed_volume<real>(get_pos(a), get_pos(b), get_pos(u), get_pos(w));
-                
-                if((V_uv >= EPSILON && V_vw >= EPSILON) || (V_vw >= EPSILON && V_wu >= EPSILON) || (V_wu >= EPSILON && V_uv >= EPSILON))
-                {
-                    q_old = Util::min(Util::quality<real>(get_pos(a), get_pos(u), get_pos(w), get_pos(v)),
-                                     Util::quality<real>(get_pos(u), get_pos(v), get_pos(b), get_pos(w)));
-                    
-                    real q_uv_old, q_uv_new, q_vw_old, q_vw_new;
-                    is_mesh::SimplexSet<edge_key> uv_edges = test_neighbour(g, a, b, u, v, q_uv_old, q_uv_new);
-                    is_mesh::SimplexSet<edge_key> vw_edges = test_neighbour(g, a, b, v, w, q_vw_old, q_vw_new);
-                    
-                    q_old = Util::min(Util::min(q_old, q_uv_old), q_vw_old);
-                    q_new = Util::min(q_uv_new, q_vw_new);
-                    
-                    if(q_new > q_old || q_new > q)
-                    {
-                        is_mesh::SimplexSet<edge_key> edges = {get_edge(f, g)};
-                        edges += uv_edges;
-                        edges += vw_edges;
-                        return edges;
-                    }
-                }
+                q_old = Util::min(min_quality(get_tets(g)), Util::min(q_uv_old, q_vw_old));
+                edges.push_back(e);
+                edges.insert(edges.end(), uv_edges.begin(), uv_edges.end());
+                edges.insert(edges.end(), vw_edges.begin(), vw_edges.end());
+                return q_remove;
             }
-            q_old = INFINITY;
-            q_new = q;
-            return {};
+            return q_keep;
         }
         
         /**
@@ -703,26 +1048,21 @@ namespace DSC {
             is_mesh::SimplexSet<node_key> apices = get_nodes(get_tets(f)) - nids;
             this->orient_cc(apices[0], nids);
             
-            real q_01_new, q_01_old, q_12_new, q_12_old, q_20_new, q_20_old;
-            is_mesh::SimplexSet<edge_key> e01 = test_neighbour(f, apices[0], apices[1], nids[0], nids[1], q_01_old, q_01_new);
-            is_mesh::SimplexSet<edge_key> e12 = test_neighbour(f, apices[0], apices[1], nids[1], nids[2], q_12_old, q_12_new);
-            is_mesh::SimplexSet<edge_key> e20 = test_neighbour(f, apices[0], apices[1], nids[2], nids[0], q_20_old, q_20_new);
-            
-            real q_old = Util::min(Util::min(Util::min(min_quality(get_tets(f)), q_01_old), q_12_old), q_20_old);
-            real q_new = Util::min(Util::min(q_01_new, q_12_new), q_20_new);
+            is_mesh::SimplexSet<face_key> visited = {f};
+            std::vector<edge_key> edges;
+            real q_old = min_quality(get_tets(f));
+            real q_new = INFINITY;
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                real q_edge_old;
+                q_new = Util::min(q_new, multi_face_removal(f, apices[0], apices[1], nids[i], nids[(i+1)%3], visited, q_edge_old, edges));
+                q_old = Util::min(q_old, q_edge_old);
+            }
             
             if(q_new > q_old)
             {
                 flip_23(f);
-                for(auto &e : e01)
-                {
-                    flip_32(e);
-                }
-                for(auto &e : e12)
-                {
-                    flip_32(e);
-                }
-                for(auto &e : e20)
+                for(auto &e : edges)
                 {
                     flip_32(e);
                 }
@@ -764,44 +1104,36 @@ namespace DSC {
          * Improve tetrahedra quality by the topological operation (re-connection) multi-face removal. It do so only for tetrahedra of quality lower than MIN_TET_QUALITY.
          * For details see "Two Discrete Optimization Algorithms for the Topological Improvement of Tetrahedral Meshes" by Shewchuk.
          */
-        void topological_face_removal()
+        int topological_face_removal()
         {
-            std::vector<tet_key> tets;
-            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            // Attempt to remove each face of each remaining low quality tetrahedron using multi-face removal, worst first.
+            // Accept if it increases the minimum quality locally.
+            int j = 0;
+            int i = improve_worst_first(pars.MIN_TET_QUALITY, j, [&](const tet_key& t)
             {
-                if (quality(tit.key()) < pars.MIN_TET_QUALITY)
+                if (!is_unsafe_editable(t))
                 {
-                    tets.push_back(tit.key());
+                    return false;
                 }
-            }
-            
-            // Attempt to remove each face of each remaining tetrahedron in tets using multi-face removal.
-            // Accept if it increases the minimum quality locally.
-            int i = 0, j = 0;
-            for (auto &t : tets)
-            {
-                if (is_unsafe_editable(t) && quality(t) < pars.MIN_TET_QUALITY)
+                for (auto f : get_faces(t))
                 {
-                    for (auto f : get_faces(t))
+                    if (is_safe_editable(f))
                     {
-                        if (is_safe_editable(f))
+                        auto apices = get_nodes(get_tets(f)) - get_nodes(f);
+                        if(topological_face_removal(apices[0], apices[1]))
                         {
-                            auto apices = get_nodes(get_tets(f)) - get_nodes(f);
-                            if(topological_face_removal(apices[0], apices[1]))
-                            {
-                                i++;
-                                break;
-                            }
+                            return true;
                         }
                     }
-                    j++;
                 }
-            }
+                return false;
+            });
 #ifdef DEBUG
             std::cout << "Topological face removals: " << i << "/" << j << std::endl;
 #endif
             
             garbage_collect();
+            return i;
         }
         
         ////////////////
@@ -819,11 +1151,11 @@ namespace DSC {
             }
             
             std::vector<edge_key> edges;
-            for (auto eit = edges_begin(); eit != edges_end(); eit++)
+            for (auto e : active_edges())
             {
-                if ((eit->is_interface() || eit->is_boundary()) && length(eit.key()) > pars.MAX_LENGTH*AVG_LENGTH)
+                if ((get(e).is_interface() || get(e).is_boundary()) && length(e) > pars.MAX_LENGTH*AVG_LENGTH)
                 {
-                    edges.push_back(eit.key());
+                    edges.push_back(e);
                 }
             }
             int i = 0;
@@ -851,11 +1183,11 @@ namespace DSC {
             }
             
             std::vector<tet_key> tetrahedra;
-            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            for (auto t : active_tets())
             {
-                if (volume(tit.key()) > pars.MAX_VOLUME*AVG_VOLUME)
+                if (volume(t) > pars.MAX_VOLUME*AVG_VOLUME)
                 {
-                    tetrahedra.push_back(tit.key());
+                    tetrahedra.push_back(t);
                 }
             }
             int i = 0;
@@ -884,11 +1216,11 @@ namespace DSC {
             }
             
             std::vector<edge_key> edges;
-            for (auto eit = edges_begin(); eit != edges_end(); eit++)
+            for (auto e : active_edges())
             {
-                if ((eit->is_interface() || eit->is_boundary()) && length(eit.key()) < pars.MIN_LENGTH*AVG_LENGTH)
+                if ((get(e).is_interface() || get(e).is_boundary()) && length(e) < pars.MIN_LENGTH*AVG_LENGTH)
                 {
-                    edges.push_back(eit.key());
+                    edges.push_back(e);
                 }
             }
             int i = 0, j = 0;
@@ -919,11 +1251,11 @@ namespace DSC {
             }
             
             std::vector<tet_key> tetrahedra;
-            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            for (auto t : active_tets())
             {
-                if (volume(tit.key()) < pars.MIN_VOLUME*AVG_VOLUME)
+                if (volume(t) < pars.MIN_VOLUME*AVG_VOLUME)
                 {
-                    tetrahedra.push_back(tit.key());
+                    tetrahedra.push_back(t);
                 }
             }
             int i = 0, j = 0;
@@ -949,21 +1281,26 @@ namespace DSC {
         /**
          * Attempt to remove edges with lower quality than DEG_EDGE_QUALITY by collapsing them.
          */
-        void remove_degenerate_edges()
+        int remove_degenerate_edges()
         {
             std::list<edge_key> edges;
-            for (auto eit = edges_begin(); eit != edges_end(); eit++)
+            for (auto e : active_edges())
             {
-                if (quality(eit.key()) < pars.DEG_EDGE_QUALITY)
+                if (quality(e) < pars.DEG_EDGE_QUALITY)
                 {
-                    edges.push_back(eit.key());
+                    edges.push_back(e);
                 }
             }
-            int i = 0, j = 0;
+            int i = 0, j = 0, k = 0;
             for(auto e : edges)
             {
-                if(exists(e) && quality(e) < pars.DEG_EDGE_QUALITY && !collapse(e))
+                if(exists(e) && quality(e) < pars.DEG_EDGE_QUALITY)
                 {
+                    if(collapse(e))
+                    {
+                        k++;
+                        continue;
+                    }
                     if(collapse(e, false))
                     {
                         i++;
@@ -975,25 +1312,31 @@ namespace DSC {
             std::cout << "Removed " << i <<"/"<< j << " degenerate edges" << std::endl;
 #endif
             garbage_collect();
+            return i + k;
         }
         
-        void remove_degenerate_faces()
+        int remove_degenerate_faces()
         {
             std::list<face_key> faces;
             
-            for (auto fit = faces_begin(); fit != faces_end(); fit++)
+            for (auto f : active_faces())
             {
-                if(quality(fit.key()) < pars.DEG_FACE_QUALITY)
+                if(quality(f) < pars.DEG_FACE_QUALITY)
                 {
-                    faces.push_back(fit.key());
+                    faces.push_back(f);
                 }
             }
             
-            int i = 0, j = 0;
+            int i = 0, j = 0, k = 0;
             for (auto &f : faces)
             {
-                if (exists(f) && quality(f) < pars.DEG_FACE_QUALITY && !collapse(f))
+                if (exists(f) && quality(f) < pars.DEG_FACE_QUALITY)
                 {
+                    if(collapse(f))
+                    {
+                        k++;
+                        continue;
+                    }
                     if(collapse(f, false))
                     {
                         i++;
@@ -1003,6 +1346,7 @@ namespace DSC {
                         if(length(e) > AVG_LENGTH)
                         {
                             split(e);
+                            k++;
                         }
                     }
                     j++;
@@ -1012,42 +1356,40 @@ namespace DSC {
             std::cout << "Removed " << i <<"/"<< j << " degenerate faces" << std::endl;
 #endif
             garbage_collect();
+            return i + k;
         }
         
-        void remove_degenerate_tets()
+        /**
+         * Attempt to remove tetrahedra with lower quality than DEG_TET_QUALITY, worst first, by collapsing or splitting them.
+         */
+        int remove_degenerate_tets()
         {
-            std::vector<tet_key> tets;
-            
-            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
+            int i = 0, j = 0, attempts;
+            int k = improve_worst_first(pars.DEG_TET_QUALITY, attempts, [&](const tet_key& t)
             {
-                if (quality(tit.key()) < pars.DEG_TET_QUALITY)
+                if (collapse(t))
                 {
-                    tets.push_back(tit.key());
+                    return true;
                 }
-            }
-            int i = 0, j = 0;
-            for (auto &t : tets)
-            {
-                if (exists(t) && quality(t) < pars.DEG_TET_QUALITY && !collapse(t))
+                j++;
+                if(collapse(t, false))
                 {
-                    if(collapse(t, false))
-                    {
-                        i++;
-                    }
-                    else {
-                        edge_key e = longest_edge(get_edges(t));
-                        if(length(e) > AVG_LENGTH)
-                        {
-                            split(e);
-                        }
-                    }
-                    j++;
+                    i++;
+                    return true;
                 }
-            }
+                edge_key e = longest_edge(get_edges(t));
+                if(length(e) > AVG_LENGTH)
+                {
+                    split(e);
+                    return true;
+                }
+                return false;
+            });
 #ifdef DEBUG
             std::cout << "Removed " << i <<"/"<< j << " degenerate tets" << std::endl;
 #endif
             garbage_collect();
+            return k;
         }
         
         //////////////////////////////////
@@ -1060,11 +1402,11 @@ namespace DSC {
         void remove_edges()
         {
             std::list<edge_key> edges;
-            for (auto eit = edges_begin(); eit != edges_end(); eit++)
+            for (auto e : active_edges())
             {
-                if (quality(eit.key()) < pars.MIN_EDGE_QUALITY)
+                if (quality(e) < pars.MIN_EDGE_QUALITY)
                 {
-                    edges.push_back(eit.key());
+                    edges.push_back(e);
                 }
             }
             int i = 0, j = 0;
@@ -1138,11 +1480,11 @@ namespace DSC {
         {
             std::list<face_key> faces;
             
-            for (auto fit = faces_begin(); fit != faces_end(); fit++)
+            for (auto f : active_faces())
             {
-                if(quality(fit.key()) < pars.MIN_FACE_QUALITY)
+                if(quality(f) < pars.MIN_FACE_QUALITY)
                 {
-                    faces.push_back(fit.key());
+                    faces.push_back(f);
                 }
             }
             
@@ -1319,29 +1661,15 @@ namespace DSC {
          */
         void remove_tets()
         {
-            std::vector<tet_key> tets;
-            
-            for (auto tit = tetrahedra_begin(); tit != tetrahedra_end(); tit++)
-            {
-                if (quality(tit.key()) < pars.MIN_TET_QUALITY)
-                {
-                    tets.push_back(tit.key());
-                }
-            }
-            int i = 0, j=0;
-            for (auto &tet : tets)
+            int j = 0;
+            int i = improve_worst_first(pars.MIN_TET_QUALITY, j, [&](const tet_key& tet)
             {
-                if (is_unsafe_editable(tet) && quality(tet) < pars.MIN_TET_QUALITY)
-                {
-                    if(remove_tet(tet))
-                    {
-                        i++;
-                    }
-                    j++;
-                }
-            }
+                return is_unsafe_editable(tet) && remove_tet(tet);
+            });
 #ifdef DEBUG
             std::cout << "Removed " << i <<"/"<< j << " low quality tets" << std::endl;
+#else
+            (void)i;
 #endif
             garbage_collect();
         }
@@ -1354,65 +1682,324 @@ namespace DSC {
          * Performs Laplacian smoothing if it improves the minimum tetrahedron quality locally.
          */
         bool smart_laplacian(const node_key& nid, real alpha = 1.)
+        {
+            vec3 new_pos;
+            real improvement;
+            if(laplacian_position(nid, new_pos, improvement, alpha))
+            {
+                set_pos(nid, new_pos);
+                return true;
+            }
+            return false;
+        }
+        
+        /**
+         * Computes the Laplacian smoothed position new_pos of the node nid and returns whether moving the node there is
+         * accepted by smart_laplacian(). The change in the minimum quality of the star is returned in improvement. The
+         * complex is only read, so this can be called concurrently for several nodes.
+         */
+        bool laplacian_position(const node_key& nid, vec3& new_pos, real& improvement, real alpha = 1.)
         {
             is_mesh::SimplexSet<tet_key> tids = get_tets(nid);
             is_mesh::SimplexSet<face_key> fids = get_faces(tids) - get_faces(nid);
             
             vec3 old_pos = get_pos(nid);
             vec3 avg_pos = get_barycenter(get_nodes(fids));
-            vec3 new_pos = old_pos + alpha * (avg_pos - old_pos);
+            new_pos = old_pos + alpha * (avg_pos - old_pos);
             
             real q_old, q_new;
             min_quality(fids, old_pos, new_pos, q_old, q_new);
-            if(q_new > pars.MIN_TET_QUALITY || q_new > q_old)
+            improvement = q_new - q_old;
+            bool accepted = q_new > pars.MIN_TET_QUALITY || q_new > q_old;
+            if (smoothing_optimization && (!accepted || q_new < pars.MIN_TET_QUALITY))
             {
-                set_pos(nid, new_pos);
-                return true;
+                // Start from the Laplacian position if it is an improvement.
+                vec3 opt_pos = accepted ? new_pos : old_pos;
+                real q_opt = optimize_position(fids, old_pos, opt_pos);
+                if (q_opt > Util::max(q_old, accepted ? q_new : q_old))
+                {
+                    new_pos = opt_pos;
+                    improvement = q_opt - q_old;
+                    return true;
+                }
             }
-            return false;
+            return accepted;
+        }
+        
+        /**
+         * Moves pos to maximize the minimum quality of the star of a node at old_pos with the link faces fids, using the
+         * optimization-based smoothing of StarOptimizer. Returns the minimum quality at the new position. The complex is
+         * only read, so this can be called concurrently for several nodes.
+         */
+        real optimize_position(const is_mesh::SimplexSet<face_key>& fids, const vec3& old_pos, vec3& pos)
+        {
+            is_mesh::StarOptimizer optimizer;
+            for (auto f : fids)
+            {
+                auto face_pos = get_pos(get_nodes(f));
+                optimizer.add_face(face_pos[0], face_pos[1], face_pos[2], old_pos);
+            }
+            return optimizer.optimize(pos);
+        }
+        
+        /**
+         * Smooths the nodes nids one color class at a time, see SmoothingMode. Returns the number of nodes moved.
+         */
+        int smooth_colored(const std::vector<node_key>& nids)
+        {
+            int moved = 0;
+            std::vector<vec3> new_pos;
+            std::vector<char> accepted;
+            for (auto& nodes : this->independent_sets(nids))
+            {
+                new_pos.resize(nodes.size());
+                accepted.assign(nodes.size(), 0);
+                this->get_thread_pool().parallel_for(0, nodes.size(), [&](size_t i)
+                {
+                    real improvement;
+                    accepted[i] = laplacian_position(nodes[i], new_pos[i], improvement);
+                }, 16);
+                
+                for (unsigned int i = 0; i < nodes.size(); i++)
+                {
+                    if (accepted[i])
+                    {
+                        set_pos(nodes[i], new_pos[i]);
+                        moved++;
+                    }
+                }
+            }
+            return moved;
         }
         
-        void smooth()
+        /**
+         * Smooths the nodes nids by Jacobi sweeps, see SmoothingMode. Returns the number of nodes moved.
+         */
+        int smooth_jacobi(const std::vector<node_key>& nids)
         {
+            size_t size = 0;
+            for (auto n : nids)
+            {
+                size = Util::max(size, static_cast<size_t>(n) + 1);
+            }
+            std::vector<int> stamp(size, -1);
+            
+            int moved = 0;
+            std::vector<node_key> nodes(nids);
+            std::vector<vec3> new_pos;
+            std::vector<real> improvement;
+            std::vector<char> accepted;
+            for (int sweep = 0; !nodes.empty(); sweep++)
+            {
+                new_pos.resize(nodes.size());
+                improvement.resize(nodes.size());
+                accepted.assign(nodes.size(), 0);
+                this->get_thread_pool().parallel_for(0, nodes.size(), [&](size_t i)
+                {
+                    accepted[i] = laplacian_position(nodes[i], new_pos[i], improvement[i]);
+                }, 16);
+                
+                // Commit the largest improvements first. A node is skipped if a neighbour has been moved in this sweep,
+                // since its position was computed with the old position of the neighbour.
+                std::vector<unsigned int> order;
+                for (unsigned int i = 0; i < nodes.size(); i++)
+                {
+                    if (accepted[i])
+                    {
+                        order.push_back(i);
+                    }
+                }
+                std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+                    return improvement[a] > improvement[b] || (improvement[a] == improvement[b] && nodes[a] < nodes[b]);
+                });
+                
+                std::vector<node_key> conflicts;
+                for (auto i : order)
+                {
+                    bool conflict = false;
+                    for (auto e : get_edges(nodes[i]))
+                    {
+                        for (auto m : get_nodes(e))
+                        {
+                            if (m != nodes[i] && static_cast<size_t>(m) < size && stamp[m] == sweep)
+                            {
+                                conflict = true;
+                            }
+                        }
+                    }
+                    if (conflict)
+                    {
+                        conflicts.push_back(nodes[i]);
+                    }
+                    else {
+                        stamp[nodes[i]] = sweep;
+                        set_pos(nodes[i], new_pos[i]);
+                        moved++;
+                    }
+                }
+                std::sort(conflicts.begin(), conflicts.end());
+                nodes.swap(conflicts);
+            }
+            return moved;
+        }
+        
+        int smooth()
+        {
+            // The nodes moved by smoothing are not seeds of the narrow band, otherwise the band would grow by its width in
+            // every call to fix_complex().
+            bool tracking = this->is_tracking_edited_nodes();
+            this->track_edited_nodes(false);
             int i = 0, j = 0;
-            for (auto nit = nodes_begin(); nit != nodes_end(); nit++)
+            if (smoothing_mode == SERIAL)
             {
-                if (is_safe_editable(nit.key()))
+                for (auto n : active_nodes())
                 {
-                    if (smart_laplacian(nit.key()))
+                    if (is_safe_editable(n))
                     {
-                        i++;
+                        if (smart_laplacian(n))
+                        {
+                            i++;
+                        }
+                        j++;
                     }
-                    j++;
                 }
             }
+            else {
+                std::vector<node_key> nids;
+                for (auto n : active_nodes())
+                {
+                    if (is_safe_editable(n))
+                    {
+                        nids.push_back(n);
+                    }
+                }
+                i = smoothing_mode == COLORED ? smooth_colored(nids) : smooth_jacobi(nids);
+                j = static_cast<int>(nids.size());
+            }
 #ifdef DEBUG
             std::cout << "Smoothed: " << i << "/" << j << std::endl;
 #endif
+            this->track_edited_nodes(tracking);
+            return i;
         }
         
         ///////////////////
         // FIX FUNCTIONS //
         ///////////////////
         
-        void fix_complex()
+        /**
+         * Runs the pass and returns the number of successful edits.
+         */
+        int run_pass(FixPass pass)
+        {
+            switch (pass) {
+                case SMOOTHING:
+                    return smooth();
+                case EDGE_REMOVAL:
+                    return topological_edge_removal();
+                case FACE_REMOVAL:
+                    return topological_face_removal();
+                case DEGENERATE_TET_REMOVAL:
+                    return remove_degenerate_tets();
+                case DEGENERATE_FACE_REMOVAL:
+                    return remove_degenerate_faces();
+                case DEGENERATE_EDGE_REMOVAL:
+                    return remove_degenerate_edges();
+            }
+            return 0;
+        }
+        
+        /**
+         * Returns whether the pass works on the queue of low quality tetrahedra, see improve_worst_first().
+         */
+        static bool uses_queue(FixPass pass)
+        {
+            return pass == EDGE_REMOVAL || pass == FACE_REMOVAL || pass == DEGENERATE_TET_REMOVAL;
+        }
+        
+        /**
+         * Improves the quality of the complex by the passes of the pipeline, see set_fix_pipeline(). Returns the nodes whose
+         * stars were edited by the passes, if the edited nodes are tracked.
+         */
+        std::vector<node_key> fix_complex()
         {
-            smooth();
+            update_band();
             
-            topological_edge_removal();
-            topological_face_removal();
+            // The nodes moved before the repair are not reported as edited by it.
+            this->take_edited_nodes();
+            
+            // The queue of low quality tetrahedra is kept up to date by the passes which work on it, so it is only rebuilt
+            // when another pass has moved nodes or edited the complex since.
+            bool queued = false;
+            for (auto pass : fix_pipeline)
+            {
+                pass_statistics& stats = pass_stats[pass];
+                stats.calls++;
+                if (stats.skip > 0)
+                {
+                    stats.skip--;
+                    continue;
+                }
+                if (uses_queue(pass) && !queued)
+                {
+                    queue_low_quality_tets();
+                    queued = true;
+                }
+                
+                auto start = std::chrono::steady_clock::now();
+                int changes = run_pass(pass);
+                real time = std::chrono::duration<real>(std::chrono::steady_clock::now() - start).count();
+                queued = queued && uses_queue(pass);
+                
+                stats.runs++;
+                stats.changes += changes;
+                stats.time += time;
+                stats.last_yield = changes/Util::max(time, 1e-9);
+                if (stats.last_yield <= min_pass_yield)
+                {
+                    stats.interval = Util::min(Util::max(2*stats.interval, 1), max_pass_interval);
+                }
+                else {
+                    stats.interval = 0;
+                }
+                stats.skip = stats.interval;
+            }
             
 //            remove_tets();
 //            remove_faces();
 //            remove_edges();
             
-            remove_degenerate_tets();
-            remove_degenerate_faces();
-            remove_degenerate_edges();
+            // The passes have handled the neighbourhoods of their own edits, so these are not seeds of the narrow band.
+            return this->take_edited_nodes();
+        }
+        
+        /**
+         * Runs fix_complex() restricted to the given number of edge rings around the nodes nids and the nodes edited since
+         * the last repair, whether or not the narrow band is used. The seeds of the narrow band are kept for resize_complex().
+         */
+        std::vector<node_key> fix_complex_locally(const std::vector<node_key>& nids, unsigned int rings)
+        {
+            int old_rings = band_rings;
+            std::vector<node_key> seeds(nids);
+            seeds.swap(band_seeds);
+            
+            band_rings = static_cast<int>(rings);
+            std::vector<node_key> edited = fix_complex();
+            band_rings = old_rings;
+            
+            if (old_rings >= 0)
+            {
+                seeds.insert(seeds.end(), band_seeds.begin(), band_seeds.end());
+            }
+            band_seeds.swap(seeds);
+            band.clear();
+            return edited;
         }
         
         void resize_complex()
         {
+            update_band();
+            
             thickening_interface();
             
             thinning_interface();
@@ -1430,6 +2017,9 @@ namespace DSC {
     public:
         /**
          * Moves all the vertices to their destination which can be set by the set_destination() function.
+         * The first step moves all movable nodes and repairs the whole complex (or the narrow band). The following steps only
+         * retry the nodes which did not reach their destination, together with the interface nodes edited by the repair,
+         * and only repair the neighbourhood of the nodes they move, so a step costs in the number of retried nodes.
          */
         void deform(int num_steps = 10)
         {
@@ -1437,32 +2027,46 @@ namespace DSC {
             validity_check();
             std::cout << std::endl << "********************************" << std::endl;
 #endif
-            int missing;
+            band_seeds.clear();
+            
+            // The nodes edited by the repair are retried as well, since collapses and splits can leave interface nodes away
+            // from their destination.
+            this->track_edited_nodes(true);
+            std::vector<node_key> nids;
+            for (auto nit = nodes_begin(); nit != nodes_end(); nit++)
+            {
+                nids.push_back(nit.key());
+            }
+            
+            std::vector<node_key> missing;
             int step = 0;
             do {
                 std::cout << "\n\tMove vertices step " << step << std::endl;
-                missing = 0;
                 int movable = 0;
-                for (auto nit = nodes_begin(); nit != nodes_end(); nit++)
-                {
-                    if (is_movable(nit.key()))
-                    {
-                        if(!move_vertex(nit.key()))
-                        {
-                            missing++;
-                        }
-                        movable++;
-                    }
-                }
-                std::cout << "\tVertices missing to be moved: " << missing <<"/" << movable << std::endl;
-                fix_complex();
+                missing = move_vertices(nids, movable);
+                std::cout << "\tVertices missing to be moved: " << missing.size() <<"/" << movable << std::endl;
+                
+                // A retry is repaired around the retried nodes, which include the nodes edited by the previous repair.
+                std::vector<node_key> edited = step == 0 ? fix_complex() : fix_complex_locally(nids, static_cast<unsigned int>(Util::max(band_rings, 1)));
 #ifdef DEBUG
-                validity_check();
+                assert(local_validity_check());
 #endif
+                nids = missing;
+                nids.insert(nids.end(), edited.begin(), edited.end());
+                std::sort(nids.begin(), nids.end());
+                nids.erase(std::unique(nids.begin(), nids.end()), nids.end());
                 ++step;
-            } while (missing > 0 && step < num_steps);
+            } while (!missing.empty() && step < num_steps);
             
+            if (band_rings < 0)
+            {
+                this->track_edited_nodes(false);
+            }
             resize_complex();
+            if (band_rings < 0)
+            {
+                this->take_edited_nodes();
+            }
             
             garbage_collect();
             for (auto nit = nodes_begin(); nit != nodes_end(); nit++)
@@ -1470,35 +2074,118 @@ namespace DSC {
                 nit->set_destination(nit->get_pos());
             }
 #ifdef DEBUG
-            validity_check();
+            assert(local_validity_check());
 #endif
         }
         
     private:
         
+        /**
+         * Moves the movable nodes among nids towards their destination, see move_vertex(), and returns the nodes which did
+         * not reach it. The number of movable nodes is returned in movable.
+         */
+        std::vector<node_key> move_vertices(const std::vector<node_key>& nids, int& movable)
+        {
+            std::vector<node_key> movable_nids;
+            for (auto n : nids)
+            {
+                if (exists(n) && is_movable(n))
+                {
+                    movable_nids.push_back(n);
+                }
+            }
+            movable = static_cast<int>(movable_nids.size());
+            
+            if (parallel_motion)
+            {
+                return move_vertices_in_batches(movable_nids);
+            }
+            std::vector<node_key> missing;
+            for (auto n : movable_nids)
+            {
+                if (!move_vertex(n))
+                {
+                    missing.push_back(n);
+                }
+            }
+            return missing;
+        }
+        
         /**
          * Tries moving the node n to the new position new_pos. Returns true if it succeeds.
          */
         bool move_vertex(const node_key & n)
+        {
+            vec3 new_pos;
+            if (!next_position(n, new_pos)) // The vertex is not moved
+            {
+                return true;
+            }
+            set_pos(n, new_pos);
+            return is_at_destination(n);
+        }
+        
+        /**
+         * Computes the position new_pos which the node n is moved to towards its destination. The node is moved at most
+         * half the distance to its link, so no tetrahedron in its star is inverted. Returns false if the node is already
+         * at its destination. The complex is only read, so this can be called concurrently for several nodes.
+         */
+        bool next_position(const node_key & n, vec3& new_pos)
         {
             vec3 pos = get_pos(n);
-            vec3 destination = get(n).get_destination();
+            vec3 destination = this->read(n).get_destination();
             real l = Util::length(destination - pos);
             
-            if (l < 1e-4*AVG_LENGTH) // The vertex is not moved
+            if (l < 1e-4*AVG_LENGTH)
             {
-                return true;
+                return false;
             }
             
             real max_l = l*intersection_with_link(n, destination) - 1e-4 * AVG_LENGTH;
             l = Util::max(Util::min(0.5*max_l, l), 0.);
-            set_pos(n, pos + l*Util::normalize(destination - pos));
-            
-            if (Util::length(destination - get_pos(n)) < 1e-4*AVG_LENGTH)
+            new_pos = pos + l*Util::normalize(destination - pos);
+            return true;
+        }
+        
+        bool is_at_destination(const node_key & n)
+        {
+            return Util::length(this->read(n).get_destination() - get_pos(n)) < 1e-4*AVG_LENGTH;
+        }
+        
+        /**
+         * Moves the nodes nids towards their destination like move_vertex() and returns the nodes which did not reach it.
+         * The nodes are split into batches in which no two nodes share a tetrahedron, see independent_sets(). The
+         * link of a node then contains no other node of its batch, so the new positions of a batch can be computed in
+         * parallel and applied together with the same guarantee as moving the nodes one by one.
+         */
+        std::vector<node_key> move_vertices_in_batches(const std::vector<node_key>& nids)
+        {
+            std::vector<std::vector<node_key>> batches = this->independent_sets(nids);
+            std::vector<node_key> missing;
+            std::vector<vec3> new_pos;
+            std::vector<char> moved;
+            for (auto& batch : batches)
             {
-                return true;
+                new_pos.resize(batch.size());
+                moved.assign(batch.size(), 0);
+                this->get_thread_pool().parallel_for(0, batch.size(), [&](size_t i)
+                {
+                    moved[i] = next_position(batch[i], new_pos[i]);
+                }, 16);
+                
+                for (unsigned int i = 0; i < batch.size(); i++)
+                {
+                    if (moved[i])
+                    {
+                        set_pos(batch[i], new_pos[i]);
+                        if (!is_at_destination(batch[i]))
+                        {
+                            missing.push_back(batch[i]);
+                        }
+                    }
+                }
             }
-            return false;
+            return missing;
         }
         
         
@@ -1797,13 +2484,10 @@ namespace DSC {
         std::vector<vec3> get_interface_face_positions()
         {
             std::vector<vec3> verts;
-            for (auto fit = faces_begin(); fit != faces_end(); fit++) {
-                if(fit->is_interface())
+            for (auto f : get_interface_faces()) {
+                for(auto n : get_nodes(f))
                 {
-                    for(auto n : get_nodes(fit.key()))
-                    {
-                        verts.push_back(get_pos(n));
-                    }
+                    verts.push_back(get_pos(n));
                 }
             }
             return verts;
@@ -1824,12 +2508,9 @@ namespace DSC {
         vec3 get_normal(const node_key& nid)
         {
             vec3 result(0.);
-            for (auto f : get_faces(nid))
+            for (auto f : get_interface_faces(nid))
             {
-                if (get(f).is_interface())
-                {
-                    result += get_normal(f);
-                }
+                result += get_normal(f);
             }
             if (Util::length(result) < EPSILON) {
                 return vec3(0.);
@@ -1877,6 +2558,19 @@ namespace DSC {
             return get_barycenter(nids, interface);
         }
         
+        /**
+         * Calculates the average position of the nodes which share an interface face with node n, found from the interface
+         * surface without visiting the tetrahedra around n. Returns the position of n if n is not interface.
+         */
+        vec3 get_interface_barycenter(const node_key& nid)
+        {
+            if(!get(nid).is_interface())
+            {
+                return get_pos(nid);
+            }
+            return get_barycenter(get_interface_surface().neighbours(nid));
+        }
+        
         ///////////////////////
         // UTILITY FUNCTIONS //
         ///////////////////////
@@ -1941,10 +2635,19 @@ namespace DSC {
             return Util::barycenter(get(nids[0]).get_destination(), get(nids[1]).get_destination(), get(nids[2]).get_destination(), get(nids[3]).get_destination());
         }
         
+        /**
+         * Returns the quality of the tetrahedron tid. The quality is cached by the mesh until the tetrahedron is edited or moved.
+         */
         real quality(const tet_key& tid)
         {
-            is_mesh::SimplexSet<node_key> nids = get_nodes(tid);
-            return std::abs(Util::quality<real>(get_pos(nids[0]), get_pos(nids[1]), get_pos(nids[2]), get_pos(nids[3])));
+            real q = this->get_cached_quality(tid);
+            if(q < 0.)
+            {
+                is_mesh::SimplexSet<node_key> nids = get_nodes(tid);
+                q = std::abs(Util::quality<real>(get_pos(nids[0]), get_pos(nids[1]), get_pos(nids[2]), get_pos(nids[3])));
+                this->cache_quality(tid, q);
+            }
+            return q;
         }
         
         real min_angle(const face_key& fid)
@@ -1959,16 +2662,25 @@ namespace DSC {
             return Util::max_angle<real>(get_pos(nids[0]), get_pos(nids[1]), get_pos(nids[2]));
         }
         
+        /**
+         * Returns the quality of the face fid. The quality is cached by the mesh until the face is edited or moved.
+         */
         real quality(const face_key& fid)
         {
-            is_mesh::SimplexSet<node_key> nids = get_nodes(fid);
-            auto angles = Util::cos_angles<real>(get_pos(nids[0]), get_pos(nids[1]), get_pos(nids[2]));
-            real worst_a = -INFINITY;
-            for(auto a : angles)
+            real q = this->get_cached_quality(fid);
+            if(q < 0.)
             {
-                worst_a = std::max(worst_a, std::abs(a));
+                is_mesh::SimplexSet<node_key> nids = get_nodes(fid);
+                auto angles = Util::cos_angles<real>(get_pos(nids[0]), get_pos(nids[1]), get_pos(nids[2]));
+                real worst_a = -INFINITY;
+                for(auto a : angles)
+                {
+                    worst_a = std::max(worst_a, std::abs(a));
+                }
+                q = 1. - worst_a;
+                this->cache_quality(fid, q);
             }
-            return 1. - worst_a;
+            return q;
         }
         
         real quality(const edge_key& eid)
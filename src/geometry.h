@@ -30,6 +30,16 @@ namespace is_mesh {
             
         }
         
+        virtual ~Geometry()
+        {
+            
+        }
+        
+        /**
+         * Returns a copy of the geometry allocated with new. Every geometry must override it, so that copies are not sliced.
+         */
+        virtual Geometry* clone() const = 0;
+        
         void invert()
         {
             inverse = !inverse;
@@ -73,6 +83,18 @@ namespace is_mesh {
             
         }
         
+        /**
+         * Copies the geometries of geometry.
+         */
+        MultipleGeometry(const MultipleGeometry& geometry)
+        {
+            for (Geometry* g : geometry.geometries) {
+                geometries.push_back(g->clone());
+            }
+        }
+        
+        MultipleGeometry& operator=(const MultipleGeometry&) = delete;
+        
         ~MultipleGeometry()
         {
             for (Geometry* g : geometries) {
@@ -80,6 +102,11 @@ namespace is_mesh {
             }
         }
         
+        virtual Geometry* clone() const override
+        {
+            return new MultipleGeometry(*this);
+        }
+        
         void add_geometry(Geometry* geometry)
         {
             geometries.push_back(geometry);
@@ -107,7 +134,7 @@ namespace is_mesh {
         
         virtual vec3 project(const vec3& p) const
         {
-            vec3 proj_p;
+            vec3 proj_p = p;
             real dist = INFINITY;
             for (Geometry* geometry : geometries)
             {
@@ -133,6 +160,11 @@ namespace is_mesh {
             
         }
         
+        virtual Geometry* clone() const override
+        {
+            return new Point(*this);
+        }
+        
         virtual bool is_inside(vec3 p) const override
         {
             return sqr_length(p - point) < EPSILON;
@@ -152,6 +184,11 @@ namespace is_mesh {
             directions.push_back(normalize(cross(directions[0], directions[1])));
         }
         
+        virtual Geometry* clone() const override
+        {
+            return new Cube(*this);
+        }
+        
         virtual bool is_inside(vec3 p) const override
         {
             if(!inverse)
@@ -199,7 +236,7 @@ namespace is_mesh {
         
         virtual vec3 project(const vec3& p) const
         {
-            vec3 proj_p;
+            vec3 proj_p = p;
             real dist = INFINITY;
             for (int i = 0; i < 3; i++) {
                 vec3 pp = Util::project_point_plane(p, point + size[i]*directions[i], directions[i]);
@@ -235,6 +272,11 @@ namespace is_mesh {
             
         }
         
+        virtual Geometry* clone() const override
+        {
+            return new Cylinder(*this);
+        }
+        
         virtual bool is_inside(vec3 p) const override
         {
             real d = dot(p - point, up_direction);
@@ -273,6 +315,11 @@ namespace is_mesh {
             
         }
         
+        virtual Geometry* clone() const override
+        {
+            return new Plane(*this);
+        }
+        
         virtual bool is_inside(vec3 p) const override
         {
             return std::abs(dot(p - point, normal)) < EPSILON;
@@ -286,6 +333,11 @@ namespace is_mesh {
         {
             
         }
+        
+        virtual Geometry* clone() const override
+        {
+            return new Circle(*this);
+        }
     };
     
     class Square : public Cube {
@@ -300,6 +352,11 @@ namespace is_mesh {
         {
             
         }
+        
+        virtual Geometry* clone() const override
+        {
+            return new Square(*this);
+        }
     };
     
 }